@@ -0,0 +1,351 @@
+//
+// Load generator for albinos-service.
+// Opens N connections, each one sending a weighted mix of CONFIG_LOAD, SETTING_GET, SETTING_UPDATE and SUBSCRIBE_SETTING
+// as fast as the service answers, and prints the throughput and latency percentiles of every request type as json.
+//
+// Without --socket, the service is embedded in the process, which is enough to compare two builds of it.
+//
+// usage: albinos-bench [--socket PATH] [--connections N] [--duration SECONDS] [--warmup SECONDS]
+//                      [--settings N] [--mix LOAD,GET,UPDATE,SUBSCRIBE]
+//
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "embedded_service.hpp"
+
+namespace
+{
+  using clock_type = std::chrono::steady_clock;
+
+  enum request_type
+  {
+      config_load,
+      setting_get,
+      setting_update,
+      subscribe_setting,
+      config_unload,
+      nb_request_types
+  };
+
+  constexpr std::array<const char *, nb_request_types> request_names{
+      "CONFIG_LOAD", "SETTING_GET", "SETTING_UPDATE", "SUBSCRIBE_SETTING", "CONFIG_UNLOAD"
+  };
+
+  struct options
+  {
+      std::optional<std::filesystem::path> socket_path;
+      std::size_t nb_connections{8};
+      std::chrono::seconds duration{5};
+      std::chrono::seconds warmup{1};
+      std::size_t nb_settings{100};
+      //! Weights of CONFIG_LOAD, SETTING_GET, SETTING_UPDATE and SUBSCRIBE_SETTING
+      std::array<unsigned int, 4> mix{10, 70, 15, 5};
+  };
+
+  //! Latencies in nanoseconds of the requests of one type, and the number of answers other than SUCCESS
+  struct request_stats
+  {
+      std::vector<std::uint64_t> latencies;
+      std::size_t nb_errors{0};
+  };
+
+  using connection_stats = std::array<request_stats, nb_request_types>;
+
+  class connection
+  {
+  public:
+    explicit connection(const std::filesystem::path &socket_path)
+    {
+        fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+        if (fd_ != -1 && ::connect(fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    ~connection() noexcept
+    {
+        if (fd_ != -1)
+            close(fd_);
+    }
+
+    connection(const connection &) = delete;
+    connection &operator=(const connection &) = delete;
+
+    bool connected() const noexcept
+    {
+        return fd_ != -1;
+    }
+
+    //! Send the request and wait for its answer, skipping the subscription events. A null json on error.
+    nlohmann::json request(nlohmann::json &request)
+    {
+        auto request_id = ++last_request_id_;
+        request["REQUEST_ID"] = request_id;
+        auto data = request.dump();
+        for (std::size_t written = 0; written < data.size();) {
+            auto nb_written = write(fd_, data.data() + written, data.size() - written);
+            if (nb_written <= 0)
+                return nullptr;
+            written += static_cast<std::size_t>(nb_written);
+        }
+        char read_data[4096];
+        while (true) {
+            while (auto message = buffer_.next()) {
+                auto answer = nlohmann::json::parse(message.value(), nullptr, false);
+                if (answer.is_discarded())
+                    return nullptr;
+                auto answer_id = answer.find("REQUEST_ID");
+                if (answer_id != answer.end() && *answer_id == request_id)
+                    return answer;
+            }
+            auto nb_read = read(fd_, read_data, sizeof(read_data));
+            if (nb_read <= 0)
+                return nullptr;
+            buffer_.feed(read_data, static_cast<std::size_t>(nb_read));
+        }
+    }
+
+  private:
+    int fd_{-1};
+    std::uint64_t last_request_id_{0};
+    raven::message_buffer buffer_;
+  };
+
+  bool succeeded(const nlohmann::json &answer)
+  {
+      return answer.is_object() && answer.value("REQUEST_STATE", "") == "SUCCESS";
+  }
+
+  std::string setting_name(std::size_t index)
+  {
+      return "setting_" + std::to_string(index);
+  }
+
+  //! Create the config every connection works on, return its key
+  std::optional<nlohmann::json> prepare_config(const std::filesystem::path &socket_path, std::size_t nb_settings)
+  {
+      connection setup{socket_path};
+      if (!setup.connected())
+          return std::nullopt;
+      nlohmann::json create{{"REQUEST_NAME", "CONFIG_CREATE"}, {"CONFIG_NAME", "albinos-bench"}};
+      auto created = setup.request(create);
+      if (!succeeded(created))
+          return std::nullopt;
+      nlohmann::json load{{"REQUEST_NAME", "CONFIG_LOAD"}, {"CONFIG_KEY", created.at("CONFIG_KEY")}};
+      auto loaded = setup.request(load);
+      if (!succeeded(loaded))
+          return std::nullopt;
+      nlohmann::json settings = nlohmann::json::object();
+      for (std::size_t i = 0; i < nb_settings; ++i)
+          settings[setting_name(i)] = "value_" + std::to_string(i);
+      nlohmann::json update{{"REQUEST_NAME", "SETTING_UPDATE"}, {"CONFIG_ID", loaded.at("CONFIG_ID")},
+                            {"SETTINGS_TO_UPDATE", std::move(settings)}};
+      if (!succeeded(setup.request(update)))
+          return std::nullopt;
+      return created.at("CONFIG_KEY");
+  }
+
+  //! Send requests until the end of the run, recording the ones sent after the warmup
+  void run_connection(const options &opts, const std::filesystem::path &socket_path, const nlohmann::json &config_key,
+                      clock_type::time_point record_start, clock_type::time_point end, unsigned int seed,
+                      connection_stats &stats)
+  {
+      connection conn{socket_path};
+      if (!conn.connected())
+          return;
+      nlohmann::json load{{"REQUEST_NAME", "CONFIG_LOAD"}, {"CONFIG_KEY", config_key}};
+      auto loaded = conn.request(load);
+      if (!succeeded(loaded))
+          return;
+      auto config_id = loaded.at("CONFIG_ID");
+
+      std::mt19937 random{seed};
+      std::discrete_distribution<int> pick_request{opts.mix.begin(), opts.mix.end()};
+      std::uniform_int_distribution<std::size_t> pick_setting{0, opts.nb_settings - 1};
+      std::uint64_t nb_updates = 0;
+      auto timed_request = [&](request_type type, nlohmann::json &request) {
+          auto start = clock_type::now();
+          auto answer = conn.request(request);
+          auto stop = clock_type::now();
+          if (start >= record_start) {
+              stats[type].latencies.push_back(
+                  static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()));
+              if (!succeeded(answer))
+                  ++stats[type].nb_errors;
+          }
+          return answer;
+      };
+
+      while (clock_type::now() < end) {
+          auto type = static_cast<request_type>(pick_request(random));
+          nlohmann::json request;
+          switch (type) {
+              case config_load: {
+                  // unloaded right away, so that the number of loaded configs stays constant
+                  auto answer = timed_request(config_load, load);
+                  if (succeeded(answer)) {
+                      nlohmann::json unload{{"REQUEST_NAME", "CONFIG_UNLOAD"}, {"CONFIG_ID", answer.at("CONFIG_ID")}};
+                      timed_request(config_unload, unload);
+                  }
+                  continue;
+              }
+              case setting_get:
+                  request = {{"REQUEST_NAME", "SETTING_GET"}, {"CONFIG_ID", config_id},
+                             {"SETTING_NAME", setting_name(pick_setting(random))}};
+                  break;
+              case setting_update:
+                  request = {{"REQUEST_NAME", "SETTING_UPDATE"}, {"CONFIG_ID", config_id},
+                             {"SETTINGS_TO_UPDATE", {{setting_name(pick_setting(random)),
+                                                      "value_" + std::to_string(seed) + "_" + std::to_string(++nb_updates)}}}};
+                  break;
+              case subscribe_setting:
+                  request = {{"REQUEST_NAME", "SUBSCRIBE_SETTING"}, {"CONFIG_ID", config_id},
+                             {"SETTING_NAME", setting_name(pick_setting(random))}};
+                  break;
+              default:
+                  continue;
+          }
+          timed_request(type, request);
+      }
+  }
+
+  double percentile_us(const std::vector<std::uint64_t> &sorted_latencies, double percentile)
+  {
+      if (sorted_latencies.empty())
+          return 0;
+      auto rank = static_cast<std::size_t>(percentile * static_cast<double>(sorted_latencies.size() - 1));
+      return static_cast<double>(sorted_latencies[rank]) / 1000.0;
+  }
+
+  nlohmann::json report(const options &opts, std::vector<connection_stats> &all_stats)
+  {
+      auto seconds = static_cast<double>(opts.duration.count());
+      nlohmann::json requests = nlohmann::json::object();
+      std::size_t nb_requests = 0;
+      std::size_t nb_errors = 0;
+      for (std::size_t type = 0; type < nb_request_types; ++type) {
+          std::vector<std::uint64_t> latencies;
+          std::size_t type_errors = 0;
+          for (auto &stats : all_stats) {
+              latencies.insert(latencies.end(), stats[type].latencies.begin(), stats[type].latencies.end());
+              type_errors += stats[type].nb_errors;
+          }
+          std::sort(latencies.begin(), latencies.end());
+          nb_requests += latencies.size();
+          nb_errors += type_errors;
+          requests[request_names[type]] = {
+              {"count",          latencies.size()},
+              {"errors",         type_errors},
+              {"throughput",     static_cast<double>(latencies.size()) / seconds},
+              {"p50_us",         percentile_us(latencies, 0.50)},
+              {"p99_us",         percentile_us(latencies, 0.99)},
+              {"p999_us",        percentile_us(latencies, 0.999)},
+              {"max_us",         latencies.empty() ? 0.0 : static_cast<double>(latencies.back()) / 1000.0}
+          };
+      }
+      return {
+          {"connections", opts.nb_connections},
+          {"duration_s",  opts.duration.count()},
+          {"warmup_s",    opts.warmup.count()},
+          {"settings",    opts.nb_settings},
+          {"mix",         {{"CONFIG_LOAD", opts.mix[0]}, {"SETTING_GET", opts.mix[1]},
+                           {"SETTING_UPDATE", opts.mix[2]}, {"SUBSCRIBE_SETTING", opts.mix[3]}}},
+          {"embedded",    !opts.socket_path.has_value()},
+          {"total",       {{"count", nb_requests}, {"errors", nb_errors},
+                           {"throughput", static_cast<double>(nb_requests) / seconds}}},
+          {"requests",    std::move(requests)}
+      };
+  }
+
+  std::optional<options> parse_options(int ac, char **av)
+  {
+      options opts;
+      for (int i = 1; i + 1 < ac; i += 2) {
+          std::string name = av[i];
+          std::string value = av[i + 1];
+          try {
+              if (name == "--socket")
+                  opts.socket_path = value;
+              else if (name == "--connections")
+                  opts.nb_connections = std::stoul(value);
+              else if (name == "--duration")
+                  opts.duration = std::chrono::seconds{std::stoul(value)};
+              else if (name == "--warmup")
+                  opts.warmup = std::chrono::seconds{std::stoul(value)};
+              else if (name == "--settings")
+                  opts.nb_settings = std::stoul(value);
+              else if (name == "--mix") {
+                  std::size_t position = 0;
+                  for (auto &weight : opts.mix) {
+                      std::size_t length = 0;
+                      weight = static_cast<unsigned int>(std::stoul(value.substr(position), &length));
+                      position += length + 1;
+                  }
+              } else
+                  return std::nullopt;
+          } catch (const std::exception &) {
+              return std::nullopt;
+          }
+      }
+      if (ac % 2 == 0 || opts.nb_connections == 0 || opts.duration.count() == 0 || opts.nb_settings == 0)
+          return std::nullopt;
+      return opts;
+  }
+}
+
+int main(int ac, char **av)
+{
+    auto opts = parse_options(ac, av);
+    if (!opts) {
+        std::cerr << "usage: " << av[0] << " [--socket PATH] [--connections N] [--duration SECONDS] [--warmup SECONDS]"
+                  << " [--settings N] [--mix LOAD,GET,UPDATE,SUBSCRIBE]" << std::endl;
+        return 1;
+    }
+    loguru::g_stderr_verbosity = loguru::Verbosity_WARNING;
+
+    auto db_path = std::filesystem::temp_directory_path() / ("albinos_bench_" + std::to_string(getpid()) + ".db");
+    std::optional<raven::embedded_service> service;
+    if (!opts->socket_path) {
+        service.emplace(db_path);
+        if (!service->listening()) {
+            std::cerr << "cannot start the embedded service" << std::endl;
+            return 1;
+        }
+    }
+    const auto socket_path = opts->socket_path.value_or(service ? service->socket_path() : std::filesystem::path{});
+
+    int status = 0;
+    if (auto config_key = prepare_config(socket_path, opts->nb_settings)) {
+        std::vector<connection_stats> all_stats(opts->nb_connections);
+        std::vector<std::thread> threads;
+        auto record_start = clock_type::now() + opts->warmup;
+        auto end = record_start + opts->duration;
+        for (std::size_t i = 0; i < opts->nb_connections; ++i)
+            threads.emplace_back(run_connection, std::cref(*opts), std::cref(socket_path), std::cref(*config_key),
+                                 record_start, end, static_cast<unsigned int>(i + 1), std::ref(all_stats[i]));
+        for (auto &thread : threads)
+            thread.join();
+        std::cout << report(*opts, all_stats).dump(4) << std::endl;
+    } else {
+        std::cerr << "cannot prepare the benchmark config on: " << socket_path << std::endl;
+        status = 1;
+    }
+    service.reset();
+    std::filesystem::remove(db_path);
+    return status;
+}
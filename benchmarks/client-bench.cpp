@@ -0,0 +1,85 @@
+#include <string>
+#include <benchmark/benchmark.h>
+#include <uvw.hpp>
+#include <loguru.hpp>
+#include "settings_interner.hpp"
+#include "client.hpp"
+
+namespace
+{
+  raven::config_id_st subscribe_settings(raven::client &client, raven::settings_interner &interner, std::size_t nb_settings)
+  {
+      auto id = client.insert_db_id(raven::config_id_st{1});
+      for (std::size_t i = 0; i < nb_settings; ++i)
+          client.subscribe(id, interner.intern("setting_" + std::to_string(i)));
+      return id;
+  }
+}
+
+static void client_is_subscribed(benchmark::State &state)
+{
+    raven::settings_interner interner;
+    raven::client client{uvw::Loop::getDefault()->resource<uvw::PipeHandle>()};
+    auto id = subscribe_settings(client, interner, static_cast<std::size_t>(state.range(0)));
+    auto setting_id = interner.intern("setting_" + std::to_string(state.range(0) / 2));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(client.is_subscribed(id, setting_id));
+}
+BENCHMARK(client_is_subscribed)->RangeMultiplier(10)->Range(10, 10000);
+
+static void client_fan_out_lookup_by_name(benchmark::State &state)
+{
+    raven::settings_interner interner;
+    raven::client client{uvw::Loop::getDefault()->resource<uvw::PipeHandle>()};
+    auto id = subscribe_settings(client, interner, static_cast<std::size_t>(state.range(0)));
+    const std::string setting_name = "setting_" + std::to_string(state.range(0) - 1);
+    for (auto _ : state) {
+        auto setting_id = interner.find(setting_name);
+        std::size_t nb_subscribed = 0;
+        if (setting_id)
+            client.for_each_subscribed_id(raven::config_id_st{1}, setting_id.value(), [&](raven::config_id_st) {
+                ++nb_subscribed;
+            });
+        benchmark::DoNotOptimize(nb_subscribed);
+    }
+}
+BENCHMARK(client_fan_out_lookup_by_name)->RangeMultiplier(10)->Range(10, 10000);
+
+static void client_subscribe_duplicate(benchmark::State &state)
+{
+    raven::settings_interner interner;
+    raven::client client{uvw::Loop::getDefault()->resource<uvw::PipeHandle>()};
+    auto id = subscribe_settings(client, interner, static_cast<std::size_t>(state.range(0)));
+    auto setting_id = interner.intern("setting_0");
+    for (auto _ : state)
+        client.subscribe(id, setting_id);
+    state.counters["subscriptions"] = static_cast<double>(client.nb_subscriptions());
+}
+BENCHMARK(client_subscribe_duplicate)->RangeMultiplier(10)->Range(10, 10000);
+
+static void client_unsubscribe_subscribe(benchmark::State &state)
+{
+    raven::settings_interner interner;
+    raven::client client{uvw::Loop::getDefault()->resource<uvw::PipeHandle>()};
+    auto id = subscribe_settings(client, interner, static_cast<std::size_t>(state.range(0)));
+    auto setting_id = interner.intern("setting_" + std::to_string(state.range(0) / 2));
+    for (auto _ : state) {
+        client.unsubscribe(id, setting_id);
+        client.subscribe(id, setting_id);
+    }
+}
+BENCHMARK(client_unsubscribe_subscribe)->RangeMultiplier(10)->Range(10, 10000);
+
+static void client_unload_config(benchmark::State &state)
+{
+    raven::settings_interner interner;
+    raven::client client{uvw::Loop::getDefault()->resource<uvw::PipeHandle>()};
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto id = subscribe_settings(client, interner, static_cast<std::size_t>(state.range(0)));
+        state.ResumeTiming();
+        for (auto setting_id : client.remove_temp_id(id))
+            interner.release(raven::setting_id_st{setting_id});
+    }
+}
+BENCHMARK(client_unload_config)->RangeMultiplier(10)->Range(10, 10000);
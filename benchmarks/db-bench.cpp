@@ -0,0 +1,157 @@
+//
+// Cost of each config_db query, apart from the rest of a request.
+// Configs hold from 10 to 100k settings, since get_config and update_config go through the whole config text.
+// Run with --benchmark_format=json, or --benchmark_out=<file>, to compare two builds.
+//
+
+#include <string>
+#include <benchmark/benchmark.h>
+#include <loguru.hpp>
+#include "protocol.hpp"
+#include "db.hpp"
+
+namespace
+{
+  //! A database in the temporary directory, removed once closed
+  class bench_db
+  {
+  public:
+    explicit bench_db(const std::string &name)
+    : file_{std::filesystem::temp_directory_path() / ("albinos_db_bench_" + name + ".db")}
+    {
+    }
+
+    raven::config_db &get() noexcept
+    {
+        return db_;
+    }
+
+  private:
+    struct file_remover
+    {
+      std::filesystem::path path;
+
+      ~file_remover()
+      {
+          std::filesystem::remove(path);
+      }
+    };
+
+    file_remover file_;
+    raven::config_db db_{prepare(file_.path)};
+
+    static const std::filesystem::path &prepare(const std::filesystem::path &path)
+    {
+        loguru::g_stderr_verbosity = loguru::Verbosity_WARNING;
+        std::filesystem::remove(path);
+        return path;
+    }
+  };
+
+  raven::json::json make_settings(std::size_t nb_settings)
+  {
+      raven::json::json settings = raven::json::json::object();
+      for (std::size_t i = 0; i < nb_settings; ++i)
+          settings["setting_" + std::to_string(i)] = "value_" + std::to_string(i);
+      return settings;
+  }
+
+  //! Create a config holding nb_settings settings
+  raven::config_create_result create_config(raven::config_db &db, std::size_t nb_settings)
+  {
+      auto result = db.config_create("db-bench");
+      auto config = db.get_config(result.config_id);
+      config[raven::config_settings_field_keyword] = make_settings(nb_settings);
+      db.update_config(config, result.config_id);
+      return result;
+  }
+
+  void check_state(benchmark::State &state, const raven::config_db &db)
+  {
+      if (db.fail())
+          state.SkipWithError("the last query failed");
+  }
+}
+
+static void db_config_create(benchmark::State &state)
+{
+    bench_db db{"create"};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(db.get().config_create("db-bench"));
+    check_state(state, db.get());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(db_config_create);
+
+static void db_get_config_name(benchmark::State &state)
+{
+    bench_db db{"get_config_name"};
+    auto id = create_config(db.get(), static_cast<std::size_t>(state.range(0))).config_id;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(db.get().get_config_name(id));
+    check_state(state, db.get());
+}
+BENCHMARK(db_get_config_name)->RangeMultiplier(10)->Range(10, 100000);
+
+//! Depends on the number of configs rather than on their size
+static void db_get_config_id(benchmark::State &state)
+{
+    bench_db db{"get_config_id"};
+    raven::config_create_result last;
+    for (int64_t i = 0; i < state.range(0); ++i)
+        last = db.get().config_create("db-bench");
+    for (auto _ : state)
+        benchmark::DoNotOptimize(db.get().get_config_id(last.config_key));
+    check_state(state, db.get());
+}
+BENCHMARK(db_get_config_id)->RangeMultiplier(10)->Range(10, 10000);
+
+static void db_get_config(benchmark::State &state)
+{
+    bench_db db{"get_config"};
+    auto id = create_config(db.get(), static_cast<std::size_t>(state.range(0))).config_id;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(db.get().get_config(id));
+    check_state(state, db.get());
+    state.counters["settings"] = static_cast<double>(state.range(0));
+}
+BENCHMARK(db_get_config)->RangeMultiplier(10)->Range(10, 100000);
+
+static void db_update_config(benchmark::State &state)
+{
+    bench_db db{"update_config"};
+    auto id = create_config(db.get(), static_cast<std::size_t>(state.range(0))).config_id;
+    auto config = db.get().get_config(id);
+    auto &value = config[raven::config_settings_field_keyword]["setting_0"];
+    std::size_t nb_updates = 0;
+    for (auto _ : state) {
+        value = "updated_" + std::to_string(++nb_updates);
+        db.get().update_config(config, id);
+    }
+    check_state(state, db.get());
+    state.counters["settings"] = static_cast<double>(state.range(0));
+}
+BENCHMARK(db_update_config)->RangeMultiplier(10)->Range(10, 100000);
+
+//! What a SETTING_UPDATE costs in the database: read, modify and write back the config
+static void db_read_modify_write(benchmark::State &state)
+{
+    bench_db db{"read_modify_write"};
+    auto id = create_config(db.get(), static_cast<std::size_t>(state.range(0))).config_id;
+    std::size_t nb_updates = 0;
+    for (auto _ : state) {
+        auto config = db.get().get_config(id);
+        config[raven::config_settings_field_keyword]["setting_0"] = "updated_" + std::to_string(++nb_updates);
+        db.get().update_config(config, id);
+    }
+    check_state(state, db.get());
+    state.counters["settings"] = static_cast<double>(state.range(0));
+}
+BENCHMARK(db_read_modify_write)->RangeMultiplier(10)->Range(10, 100000);
+
+static void db_random_string(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(raven::random_string(static_cast<std::size_t>(state.range(0))));
+}
+BENCHMARK(db_random_string)->RangeMultiplier(2)->Range(8, 128);
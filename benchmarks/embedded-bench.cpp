@@ -0,0 +1,126 @@
+//
+// Round trip of a SETTING_GET through an embedded service, without a separate albinos-service.
+// Comparing the socketpair and the socket path runs isolates the cost of connecting through the filesystem,
+// and both against the handler microbenchmarks gives the IPC overhead.
+// allocations_per_round_trip counts every operator new of the process, the client side included.
+//
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+#include "embedded_service.hpp"
+
+namespace
+{
+  std::atomic<std::uint64_t> nb_allocations{0};
+}
+
+void *operator new(std::size_t size)
+{
+    nb_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+  nlohmann::json round_trip(int fd, const std::string &request, raven::message_buffer &buffer)
+  {
+      if (write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size()))
+          return nullptr;
+      char data[4096];
+      while (true) {
+          if (auto message = buffer.next())
+              return nlohmann::json::parse(message.value());
+          auto nb_read = read(fd, data, sizeof(data));
+          if (nb_read <= 0)
+              return nullptr;
+          buffer.feed(data, static_cast<std::size_t>(nb_read));
+      }
+  }
+
+  int connect_path(const std::filesystem::path &socket_path)
+  {
+      int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      sockaddr_un address{};
+      address.sun_family = AF_UNIX;
+      std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+      if (fd != -1 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1) {
+          close(fd);
+          return -1;
+      }
+      return fd;
+  }
+
+  //! Create and load a config holding one setting, return the SETTING_GET request reading it
+  std::string prepare_config(int fd, raven::message_buffer &buffer)
+  {
+      auto created = round_trip(fd, R"({"REQUEST_NAME": "CONFIG_CREATE", "CONFIG_NAME": "embedded-bench"})", buffer);
+      nlohmann::json load{{"REQUEST_NAME", "CONFIG_LOAD"}, {"CONFIG_KEY", created.at("CONFIG_KEY")}};
+      auto loaded = round_trip(fd, load.dump(), buffer);
+      nlohmann::json update{{"REQUEST_NAME", "SETTING_UPDATE"}, {"CONFIG_ID", loaded.at("CONFIG_ID")},
+                            {"SETTINGS_TO_UPDATE", {{"setting", "value"}}}};
+      round_trip(fd, update.dump(), buffer);
+      nlohmann::json get{{"REQUEST_NAME", "SETTING_GET"}, {"CONFIG_ID", loaded.at("CONFIG_ID")},
+                         {"SETTING_NAME", "setting"}};
+      return get.dump();
+  }
+
+  void run_round_trips(benchmark::State &state, int fd)
+  {
+      if (fd == -1) {
+          state.SkipWithError("cannot connect to the embedded service");
+          return;
+      }
+      raven::message_buffer buffer;
+      auto request = prepare_config(fd, buffer);
+      auto nb_allocations_before = nb_allocations.load(std::memory_order_relaxed);
+      for (auto _ : state)
+          benchmark::DoNotOptimize(round_trip(fd, request, buffer));
+      state.SetItemsProcessed(state.iterations());
+      state.counters["allocations_per_round_trip"] = benchmark::Counter(
+          static_cast<double>(nb_allocations.load(std::memory_order_relaxed) - nb_allocations_before),
+          benchmark::Counter::kAvgIterations);
+      close(fd);
+  }
+}
+
+static void embedded_round_trip_socketpair(benchmark::State &state)
+{
+    auto db_path = std::filesystem::temp_directory_path() / "albinos_embedded_bench_pair.db";
+    {
+        raven::embedded_service service{db_path};
+        run_round_trips(state, service.connect_pair());
+    }
+    std::filesystem::remove(db_path);
+}
+BENCHMARK(embedded_round_trip_socketpair);
+
+static void embedded_round_trip_socket_path(benchmark::State &state)
+{
+    auto db_path = std::filesystem::temp_directory_path() / "albinos_embedded_bench_path.db";
+    {
+        raven::embedded_service service{db_path};
+        run_round_trips(state, service.listening() ? connect_path(service.socket_path()) : -1);
+    }
+    std::filesystem::remove(db_path);
+}
+BENCHMARK(embedded_round_trip_socket_path);
@@ -0,0 +1,79 @@
+//
+// Throughput of libalbinos setting reads from concurrent threads.
+// Needs a running albinos-service.
+//
+
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "Albinos.h"
+
+namespace
+{
+  constexpr std::size_t nb_settings = 30;
+
+  struct shared_config
+  {
+      Albinos::Config *config{nullptr};
+
+      explicit shared_config(bool cache_enabled)
+      {
+          Albinos::setIoThreadEnabled(1);
+          if (Albinos::createConfig("lib-bench", &config) != Albinos::SUCCESS) {
+              config = nullptr;
+              return;
+          }
+          Albinos::setSettingsCacheEnabled(config, cache_enabled);
+          for (std::size_t i = 0; i < nb_settings; ++i) {
+              auto name = "setting_" + std::to_string(i);
+              Albinos::setSetting(config, name.c_str(), "value");
+          }
+      }
+
+      ~shared_config()
+      {
+          if (config) {
+              Albinos::destroyConfig(config);
+              Albinos::releaseConfig(config);
+          }
+      }
+  };
+
+  std::vector<std::string> setting_names()
+  {
+      std::vector<std::string> names;
+      for (std::size_t i = 0; i < nb_settings; ++i)
+          names.push_back("setting_" + std::to_string(i));
+      return names;
+  }
+
+  void read_settings(benchmark::State &state, Albinos::Config *config)
+  {
+      if (!config) {
+          state.SkipWithError("cannot reach albinos-service");
+          return;
+      }
+      auto names = setting_names();
+      char value[64];
+      std::size_t i = static_cast<std::size_t>(state.thread_index);
+      for (auto _ : state) {
+          auto result = Albinos::getSettingValue(config, names[i++ % nb_settings].c_str(), value, sizeof(value));
+          benchmark::DoNotOptimize(result);
+      }
+      state.SetItemsProcessed(state.iterations());
+  }
+}
+
+static void lib_concurrent_reads_cached(benchmark::State &state)
+{
+    static shared_config shared{true};
+    read_settings(state, shared.config);
+}
+BENCHMARK(lib_concurrent_reads_cached)->Threads(1)->Threads(8)->UseRealTime();
+
+static void lib_concurrent_reads_uncached(benchmark::State &state)
+{
+    static shared_config shared{false};
+    read_settings(state, shared.config);
+}
+BENCHMARK(lib_concurrent_reads_uncached)->Threads(1)->Threads(8)->UseRealTime();
@@ -0,0 +1,82 @@
+//
+// Decoding of the service answers by libalbinos, for every answer type.
+// The "exceptions" counter must stay at 0 on these successful answers.
+//
+
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "Response.hpp"
+
+namespace
+{
+  using json = nlohmann::json;
+
+  struct answer_sample
+  {
+      Albinos::ResponseType type;
+      json answer;
+  };
+
+  std::vector<answer_sample> const &samples()
+  {
+      static std::vector<answer_sample> const all{
+          {Albinos::ResponseType::STATE, R"({"REQUEST_STATE": "SUCCESS", "REQUEST_ID": 1})"_json},
+          {Albinos::ResponseType::CONFIG_KEYS,
+           R"({"REQUEST_STATE": "SUCCESS", "CONFIG_KEY": "0123456789abcdef", "READONLY_CONFIG_KEY": "fedcba9876543210"})"_json},
+          {Albinos::ResponseType::CONFIG_INFO, R"({"REQUEST_STATE": "SUCCESS", "CONFIG_NAME": "bench", "CONFIG_ID": 42})"_json},
+          {Albinos::ResponseType::SETTING_VALUE, R"({"REQUEST_STATE": "SUCCESS", "SETTING_VALUE": "value"})"_json},
+          {Albinos::ResponseType::SETTINGS,
+           R"({"REQUEST_STATE": "SUCCESS", "SETTINGS": {"setting_0": "value", "setting_1": "value"}})"_json},
+          {Albinos::ResponseType::SETTINGS_NAMES, R"({"REQUEST_STATE": "SUCCESS", "SETTINGS_NAMES": ["setting_0", "setting_1"]})"_json},
+          {Albinos::ResponseType::DEPS, R"({"REQUEST_STATE": "SUCCESS", "DEPS": [1, 2, 3]})"_json},
+      };
+      return all;
+  }
+
+  // the decoding done by Config::parseResponse before answers were typed
+  void try_each_answer_type(json const &data)
+  {
+      try {
+          benchmark::DoNotOptimize(data.at("CONFIG_NAME").get<std::string>());
+          benchmark::DoNotOptimize(data.at("CONFIG_ID").get<uint32_t>());
+          return;
+      } catch (...) {
+      }
+      try {
+          benchmark::DoNotOptimize(data.at("CONFIG_KEY").get<std::string>());
+          benchmark::DoNotOptimize(data.at("READONLY_CONFIG_KEY").get<std::string>());
+          return;
+      } catch (...) {
+      }
+      try {
+          benchmark::DoNotOptimize(data.at("SETTINGS_NAMES").get<std::vector<std::string>>());
+          return;
+      } catch (...) {
+      }
+  }
+}
+
+static void lib_response_decode(benchmark::State &state)
+{
+    auto const &sample = samples()[static_cast<std::size_t>(state.range(0))];
+    std::size_t exceptions = 0;
+    for (auto _ : state) {
+        try {
+            Albinos::Response response(sample.type, sample.answer);
+            benchmark::DoNotOptimize(response.getResult());
+        } catch (...) {
+            ++exceptions;
+        }
+    }
+    state.counters["exceptions"] = static_cast<double>(exceptions);
+}
+BENCHMARK(lib_response_decode)->DenseRange(0, 6);
+
+static void lib_response_try_catch_chain(benchmark::State &state)
+{
+    auto const &sample = samples()[static_cast<std::size_t>(state.range(0))];
+    for (auto _ : state)
+        try_each_answer_type(sample.answer);
+}
+BENCHMARK(lib_response_try_catch_chain)->DenseRange(0, 6);
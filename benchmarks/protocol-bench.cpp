@@ -0,0 +1,240 @@
+//
+// Conversions between the protocol structs and json, apart from the socket and the database.
+// decode benchmarks start from the received text, like handle_message, and encode ones end with the text sent.
+// write benchmarks end with the same text, serialized by the json_writer into a reused buffer like the service does.
+// Run with --benchmark_format=json, or --benchmark_out=<file>, to compare two builds.
+//
+
+#include <string>
+#include <benchmark/benchmark.h>
+#include "protocol.hpp"
+
+namespace
+{
+  template <typename TRequest>
+  void decode(benchmark::State &state, const std::string &text)
+  {
+      for (auto _ : state) {
+          auto request = raven::json::json::parse(text).get<TRequest>();
+          benchmark::DoNotOptimize(request);
+      }
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+  }
+
+  template <typename TAnswer>
+  void encode(benchmark::State &state, const TAnswer &answer)
+  {
+      std::size_t nb_bytes = 0;
+      for (auto _ : state) {
+          raven::json::json json_answer = answer;
+          auto text = json_answer.dump();
+          nb_bytes += text.size();
+          benchmark::DoNotOptimize(text);
+      }
+      state.SetBytesProcessed(static_cast<int64_t>(nb_bytes));
+  }
+
+  template <typename TAnswer>
+  void write(benchmark::State &state, const TAnswer &answer)
+  {
+      std::size_t nb_bytes = 0;
+      std::string text;
+      for (auto _ : state) {
+          text.clear();
+          raven::json_writer writer{text};
+          writer.begin_object();
+          write_json(writer, answer);
+          writer.end_object();
+          nb_bytes += text.size();
+          benchmark::DoNotOptimize(text.data());
+      }
+      state.SetBytesProcessed(static_cast<int64_t>(nb_bytes));
+  }
+
+  raven::json::json make_names(std::size_t nb_settings)
+  {
+      raven::json::json names = raven::json::json::array();
+      for (std::size_t i = 0; i < nb_settings; ++i)
+          names.push_back("setting_" + std::to_string(i));
+      return names;
+  }
+
+  raven::json::json make_settings(std::size_t nb_settings)
+  {
+      raven::json::json settings = raven::json::json::object();
+      for (std::size_t i = 0; i < nb_settings; ++i)
+          settings["setting_" + std::to_string(i)] = "value_" + std::to_string(i);
+      return settings;
+  }
+
+  std::size_t range(benchmark::State &state)
+  {
+      return static_cast<std::size_t>(state.range(0));
+  }
+}
+
+static void protocol_decode_config_create(benchmark::State &state)
+{
+    decode<raven::config_create>(state, R"({"REQUEST_NAME": "CONFIG_CREATE", "CONFIG_NAME": "protocol-bench"})");
+}
+BENCHMARK(protocol_decode_config_create);
+
+static void protocol_decode_config_load(benchmark::State &state)
+{
+    decode<raven::config_load>(state, R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY": "0123456789abcdef0123456789abcdef"})");
+}
+BENCHMARK(protocol_decode_config_load);
+
+static void protocol_decode_config_unload(benchmark::State &state)
+{
+    decode<raven::config_unload>(state, R"({"REQUEST_NAME": "CONFIG_UNLOAD", "CONFIG_ID": 42})");
+}
+BENCHMARK(protocol_decode_config_unload);
+
+static void protocol_decode_config_include(benchmark::State &state)
+{
+    decode<raven::config_include>(state, R"({"REQUEST_NAME": "CONFIG_INCLUDE", "CONFIG_ID": 42, "SRC": 43})");
+}
+BENCHMARK(protocol_decode_config_include);
+
+static void protocol_decode_setting_update(benchmark::State &state)
+{
+    raven::json::json request{{"REQUEST_NAME", "SETTING_UPDATE"}, {"CONFIG_ID", 42},
+                              {"SETTINGS_TO_UPDATE", make_settings(range(state))}};
+    decode<raven::setting_update>(state, request.dump());
+}
+BENCHMARK(protocol_decode_setting_update)->RangeMultiplier(10)->Range(1, 10000);
+
+static void protocol_decode_setting_remove(benchmark::State &state)
+{
+    decode<raven::setting_remove>(state, R"({"REQUEST_NAME": "SETTING_REMOVE", "CONFIG_ID": 42, "SETTING_NAME": "setting"})");
+}
+BENCHMARK(protocol_decode_setting_remove);
+
+static void protocol_decode_settings_remove(benchmark::State &state)
+{
+    raven::json::json request{{"REQUEST_NAME", "SETTINGS_REMOVE"}, {"CONFIG_ID", 42},
+                              {"SETTINGS_NAMES", make_names(range(state))}};
+    decode<raven::settings_remove>(state, request.dump());
+}
+BENCHMARK(protocol_decode_settings_remove)->RangeMultiplier(10)->Range(1, 10000);
+
+static void protocol_decode_setting_get(benchmark::State &state)
+{
+    decode<raven::setting_get>(state, R"({"REQUEST_NAME": "SETTING_GET", "CONFIG_ID": 42, "SETTING_NAME": "setting"})");
+}
+BENCHMARK(protocol_decode_setting_get);
+
+static void protocol_decode_settings_get(benchmark::State &state)
+{
+    raven::json::json request{{"REQUEST_NAME", "SETTINGS_GET"}, {"CONFIG_ID", 42},
+                              {"SETTINGS_NAMES", make_names(range(state))}};
+    decode<raven::settings_get>(state, request.dump());
+}
+BENCHMARK(protocol_decode_settings_get)->RangeMultiplier(10)->Range(1, 10000);
+
+static void protocol_decode_config_get_settings(benchmark::State &state)
+{
+    decode<raven::config_get_settings>(state, R"({"REQUEST_NAME": "CONFIG_GET_SETTINGS", "CONFIG_ID": 42})");
+}
+BENCHMARK(protocol_decode_config_get_settings);
+
+static void protocol_decode_config_get_settings_names(benchmark::State &state)
+{
+    decode<raven::config_get_settings_names>(state, R"({"REQUEST_NAME": "CONFIG_GET_SETTINGS_NAMES", "CONFIG_ID": 42})");
+}
+BENCHMARK(protocol_decode_config_get_settings_names);
+
+static void protocol_decode_alias_set(benchmark::State &state)
+{
+    decode<raven::alias_set>(state,
+                             R"({"REQUEST_NAME": "ALIAS_SET", "CONFIG_ID": 42, "SETTING_NAME": "setting", "ALIAS_NAME": "alias"})");
+}
+BENCHMARK(protocol_decode_alias_set);
+
+static void protocol_decode_alias_unset(benchmark::State &state)
+{
+    decode<raven::alias_unset>(state, R"({"REQUEST_NAME": "ALIAS_UNSET", "CONFIG_ID": 42, "ALIAS_NAME": "alias"})");
+}
+BENCHMARK(protocol_decode_alias_unset);
+
+static void protocol_decode_setting_subscribe(benchmark::State &state)
+{
+    decode<raven::setting_subscribe>(state,
+                                     R"({"REQUEST_NAME": "SUBSCRIBE_SETTING", "CONFIG_ID": 42, "SETTING_NAME": "setting"})");
+}
+BENCHMARK(protocol_decode_setting_subscribe);
+
+static void protocol_decode_setting_unsubscribe(benchmark::State &state)
+{
+    decode<raven::setting_unsubscribe>(state,
+                                       R"({"REQUEST_NAME": "UNSUBSCRIBE_SETTING", "CONFIG_ID": 42, "ALIAS_NAME": "alias"})");
+}
+BENCHMARK(protocol_decode_setting_unsubscribe);
+
+static void protocol_decode_subscribe_event(benchmark::State &state)
+{
+    decode<raven::subscribe_event>(state, R"({"CONFIG_ID": 42, "SETTING_NAME": "setting", "SUBSCRIBE_EVENT_TYPE": "UPDATE"})");
+}
+BENCHMARK(protocol_decode_subscribe_event);
+
+static void protocol_encode_config_create_answer(benchmark::State &state)
+{
+    encode(state, raven::config_create_answer{raven::config_key_st{"0123456789abcdef0123456789abcdef"},
+                                              raven::config_key_st{"fedcba9876543210fedcba9876543210"}, "SUCCESS"});
+}
+BENCHMARK(protocol_encode_config_create_answer);
+
+static void protocol_encode_config_load_answer(benchmark::State &state)
+{
+    encode(state, raven::config_load_answer{"protocol-bench", raven::config_id_st{42}, "SUCCESS"});
+}
+BENCHMARK(protocol_encode_config_load_answer);
+
+static void protocol_encode_setting_get_answer(benchmark::State &state)
+{
+    encode(state, raven::setting_get_answer{"value", "SUCCESS"});
+}
+BENCHMARK(protocol_encode_setting_get_answer);
+
+static void protocol_encode_config_get_settings_names_answer(benchmark::State &state)
+{
+    encode(state, raven::config_get_settings_names_answer{make_names(range(state)), "SUCCESS"});
+}
+BENCHMARK(protocol_encode_config_get_settings_names_answer)->RangeMultiplier(10)->Range(1, 10000);
+
+static void protocol_encode_config_get_settings_answer(benchmark::State &state)
+{
+    encode(state, raven::config_get_settings_answer{make_settings(range(state)), "SUCCESS"});
+}
+BENCHMARK(protocol_encode_config_get_settings_answer)->RangeMultiplier(10)->Range(1, 10000);
+
+static void protocol_encode_subscribe_event(benchmark::State &state)
+{
+    encode(state, raven::subscribe_event{raven::config_id_st{42}, "setting", raven::subscribe_event_type::update_setting});
+}
+BENCHMARK(protocol_encode_subscribe_event);
+
+static void protocol_write_config_load_answer(benchmark::State &state)
+{
+    write(state, raven::config_load_answer{"protocol-bench", raven::config_id_st{42}, "SUCCESS"});
+}
+BENCHMARK(protocol_write_config_load_answer);
+
+static void protocol_write_setting_get_answer(benchmark::State &state)
+{
+    write(state, raven::setting_get_answer{"value", "SUCCESS"});
+}
+BENCHMARK(protocol_write_setting_get_answer);
+
+static void protocol_write_config_get_settings_answer(benchmark::State &state)
+{
+    write(state, raven::config_get_settings_answer{make_settings(range(state)), "SUCCESS"});
+}
+BENCHMARK(protocol_write_config_get_settings_answer)->RangeMultiplier(10)->Range(1, 10000);
+
+static void protocol_write_subscribe_event(benchmark::State &state)
+{
+    write(state, raven::subscribe_event{raven::config_id_st{42}, "setting", raven::subscribe_event_type::update_setting});
+}
+BENCHMARK(protocol_write_subscribe_event);
@@ -16,6 +16,7 @@
 #endif
 
 # include <stddef.h>
+# include <stdint.h>
 
 #ifdef __cplusplus
 namespace Albinos
@@ -42,6 +43,19 @@ namespace Albinos
        KEY_NOT_INITIALIZED,		///< returned by getReadOnlyConfigKey() or getConfigKey() if the requested key wasn't set up
 
        INVALID_REPONSE_FROM_SERVICE,	///< returned if service provide invalid response
+
+       UNKNOWN_SETTING,			///< returned if the requested setting doesn't exist
+
+       REQUEST_FAILED,			///< returned if the service couldn't process the request
+
+       REQUEST_PENDING,			///< returned by getRequestResult() while the answer hasn't been delivered
+
+       WRONG_SETTING_TYPE,		///< returned by the typed getters if the setting holds a value of another type
+
+       UPDATE_IN_PROGRESS,		///< returned by beginUpdate() if an update was already begun
+       NO_UPDATE_IN_PROGRESS,		///< returned by commitUpdate() or cancelUpdate() without a matching beginUpdate()
+
+       LIMIT_EXCEEDED,			///< returned if the service refused the request because the client went over one of its limits
       };
 
     ///
@@ -58,6 +72,18 @@ namespace Albinos
     ///
     typedef void (*FCPTR_ON_CHANGE_NOTIFIER)(struct Subscription const *, enum ModifType);
 
+    ///
+    /// \brief type of a setting's value, kept by the service
+    ///
+    enum SettingType
+      {
+       STRING_VALUE,	///< set with setSetting()
+       INT_VALUE,	///< set with setSettingInt()
+       DOUBLE_VALUE,	///< set with setSettingDouble()
+       BOOL_VALUE,	///< set with setSettingBool()
+       BLOB_VALUE,	///< set with setSettingBlob()
+      };
+
     ///
     /// \brief indicate the key type
     ///
@@ -109,6 +135,93 @@ namespace Albinos
     ///
     void unsubscribe(struct Subscription *subscription);
 
+    ///
+    ///
+    /// REQUEST
+    ///
+    ///
+
+    ///
+    /// represents a request sent without waiting for its answer
+    ///
+    struct Request;
+
+    ///
+    /// \brief type of function pointer called when the answer of an asynchronous request is delivered
+    ///
+    typedef void (*FCPTR_ON_REQUEST_COMPLETED)(struct Request const *, enum ReturnedValue);
+
+    ///
+    /// \brief release a request obtained from one of the *Async() functions
+    /// \param request the request to release. If its answer wasn't delivered yet, it will be freed once it is.
+    ///
+    void releaseRequest(struct Request *request);
+
+    ///
+    /// \brief get the result of a request
+    /// \param request the request
+    /// \return REQUEST_PENDING until the answer is delivered by pollRequests(), then the error code of the request
+    ///
+    enum ReturnedValue getRequestResult(struct Request const *request);
+
+    ///
+    /// \brief get the value returned by a request, like the setting value for getSettingValueAsync()
+    /// \param request the request
+    /// \return the value, NULL while the answer isn't delivered. The string lives as long as the request.
+    ///
+    char const *getRequestValue(struct Request const *request);
+
+    ///
+    /// \brief get a request's user data
+    /// \param request the request to query the user data from
+    /// \return the user data
+    ///
+    void *getRequestUserData(struct Request const *request);
+
+    ///
+    ///
+    /// THREADING
+    ///
+    ///
+
+    ///
+    /// \brief run the connection to the service on a background I/O thread. Disabled by default.
+    /// \param enabled 0 to disable the I/O thread, anything else to enable it
+    ///
+    ///	The connection is shared by all configs, so this takes effect the next time it is opened,
+    ///	which is when a config is created while no other config exists.\n
+    ///	With the I/O thread, all functions can be called from any thread, and several threads can use the same config.
+    ///	Callbacks are still called by pollRequests() and pollSubscriptions(), in the thread calling them.\n
+    ///	The connection is opened to the socket given by the ALBINOS_SOCKET_PATH environment variable, if set.
+    ///
+    void setIoThreadEnabled(int enabled);
+
+    ///
+    ///
+    /// TRACING
+    ///
+    ///
+
+    ///
+    /// \brief record the path of every request, in the library and in the service. Disabled by default.
+    /// \param enabled 0 to disable tracing, anything else to enable it
+    /// \return error code of the service, which records its spans for every client while enabled
+    ///
+    ///	The service is only told if a Config is alive, as the process has no connection otherwise.
+    ///
+    ///	Each request is tagged with a TRACE_ID, so that its spans in both processes are linked in a trace viewer.
+    ///
+    enum ReturnedValue setTracingEnabled(int enabled);
+
+    ///
+    /// \brief write the spans recorded since the last call, by the library and by the service, in a file
+    /// \param path file to write, in Chrome trace-event json format, which chrome://tracing or Perfetto can open
+    /// \return error code. The file holds the spans of the library even if the ones of the service couldn't be fetched.
+    ///
+    ///	The spans of the service are only fetched if a Config is alive, as the process has no connection otherwise.
+    ///
+    enum ReturnedValue writeTrace(char const *path);
+
     ///
     ///
     /// CONFIG
@@ -155,6 +268,8 @@ namespace Albinos
     /// \brief release the config, freeing the underlying memory. Must be called when config is no longer used.
     /// \param config the config to release
     ///
+    ///	Asynchronous requests still waiting for their answer are delivered with CONNECTION_ERROR.
+    ///
     void releaseConfig(struct Config const *config);
 
     ///
@@ -178,10 +293,47 @@ namespace Albinos
     /// \param config the config to add a setting to
     /// \param name setting name
     /// \param value new setting value
-    /// \return error code
+    /// \return error code, REQUEST_FAILED if the service refused the value. The typed setters below return the same.
     ///
     enum ReturnedValue setSetting(struct Config *config, char const *name, char const *value);
 
+    ///
+    /// \brief add or modify a setting holding an integer
+    /// \param config the config to add a setting to
+    /// \param name setting name
+    /// \param value new setting value
+    /// \return error code
+    ///
+    enum ReturnedValue setSettingInt(struct Config *config, char const *name, int64_t value);
+
+    ///
+    /// \brief add or modify a setting holding a floating point number
+    /// \param config the config to add a setting to
+    /// \param name setting name
+    /// \param value new setting value, must be finite
+    /// \return error code
+    ///
+    enum ReturnedValue setSettingDouble(struct Config *config, char const *name, double value);
+
+    ///
+    /// \brief add or modify a setting holding a boolean
+    /// \param config the config to add a setting to
+    /// \param name setting name
+    /// \param value new setting value, any non zero value is true
+    /// \return error code
+    ///
+    enum ReturnedValue setSettingBool(struct Config *config, char const *name, int value);
+
+    ///
+    /// \brief add or modify a setting holding binary data
+    /// \param config the config to add a setting to
+    /// \param name setting name
+    /// \param data the bytes to store, can be NULL if 'size' is 0
+    /// \param size number of bytes in 'data'
+    /// \return error code
+    ///
+    enum ReturnedValue setSettingBlob(struct Config *config, char const *name, void const *data, size_t size);
+
     ///
     /// \brief set or modify an alias
     /// \param config the config to add a setting alias to
@@ -203,10 +355,46 @@ namespace Albinos
     /// \brief remove the given setting
     /// \param config the config to remove a setting from
     /// \param name setting name
-    /// \return error code
+    /// \return error code, UNKNOWN_SETTING if the config doesn't have it
     ///
     enum ReturnedValue removeSetting(struct Config *config, char const *name);
 
+    ///
+    /// \brief remove several settings at once. Nothing is removed if one of them doesn't exist
+    /// \param config the config to remove the settings from
+    /// \param names array of setting names
+    /// \param count size of the 'names' array
+    /// \return error code, UNKNOWN_SETTING if one of them doesn't exist
+    ///
+    enum ReturnedValue removeSettings(struct Config *config, char const * const *names, size_t count);
+
+    ///
+    /// \brief start buffering the changes made to the config, until commitUpdate() or cancelUpdate()
+    /// \param config the config to update
+    /// \return error code
+    ///
+    ///	Every setSetting*(), removeSetting() and removeSettings() call then only records the change and returns SUCCESS.
+    ///	Reads still give the values known by the service. Asynchronous requests are not buffered.
+    ///
+    enum ReturnedValue beginUpdate(struct Config *config);
+
+    ///
+    /// \brief send the changes buffered since beginUpdate() in a single request
+    /// \param config the updated config
+    /// \return error code
+    ///
+    ///	The service applies all of them or none, and notifies the subscribers once all of them are applied.
+    ///	Only the last change of a setting is kept. Removing a setting which doesn't exist isn't an error here.
+    ///
+    enum ReturnedValue commitUpdate(struct Config *config);
+
+    ///
+    /// \brief drop the changes buffered since beginUpdate()
+    /// \param config the updated config
+    /// \return error code
+    ///
+    enum ReturnedValue cancelUpdate(struct Config *config);
+
     ///
     /// \brief get the setting's value
     /// \param config the config
@@ -215,8 +403,80 @@ namespace Albinos
     /// \param valueSize must contain the size of the buffer pointed by 'value'
     /// \return error code
     ///
+    ///	Numbers and booleans are written as text, blobs as their bytes.
+    ///
     enum ReturnedValue getSettingValue(struct Config const *config, char const *settingName, char *value, size_t valueSize);
 
+    ///
+    /// \brief get the type of the setting's value
+    /// \param config the config
+    /// \param settingName setting name
+    /// \param type the type will be written here
+    /// \return error code
+    ///
+    enum ReturnedValue getSettingType(struct Config const *config, char const *settingName, enum SettingType *type);
+
+    ///
+    /// \brief get the value of a setting holding an integer
+    /// \param config the config
+    /// \param settingName setting name
+    /// \param value the value will be written here
+    /// \return error code, WRONG_SETTING_TYPE if the setting doesn't hold an integer
+    ///
+    enum ReturnedValue getSettingInt(struct Config const *config, char const *settingName, int64_t *value);
+
+    ///
+    /// \brief get the value of a setting holding a number
+    /// \param config the config
+    /// \param settingName setting name
+    /// \param value the value will be written here, converted if the setting holds an integer
+    /// \return error code, WRONG_SETTING_TYPE if the setting doesn't hold a number
+    ///
+    enum ReturnedValue getSettingDouble(struct Config const *config, char const *settingName, double *value);
+
+    ///
+    /// \brief get the value of a setting holding a boolean
+    /// \param config the config
+    /// \param settingName setting name
+    /// \param value 1 or 0 will be written here
+    /// \return error code, WRONG_SETTING_TYPE if the setting doesn't hold a boolean
+    ///
+    enum ReturnedValue getSettingBool(struct Config const *config, char const *settingName, int *value);
+
+    ///
+    /// \brief get the bytes of a setting holding binary data. Their number is given by getSettingSize().
+    /// \param config the config
+    /// \param settingName setting name
+    /// \param data the bytes will be written here without exceeding 'size' bytes
+    /// \param size must contain the size of the buffer pointed by 'data'
+    /// \return error code, WRONG_SETTING_TYPE if the setting doesn't hold binary data
+    ///
+    enum ReturnedValue getSettingBlob(struct Config const *config, char const *settingName, void *data, size_t size);
+
+    ///
+    /// \brief get several settings' values in a single request
+    /// \param config the config
+    /// \param names array of setting names
+    /// \param count size of the 'names' array
+    /// \param settings array of 'count' settings, in the order of 'names'. Must be released using destroySettingsArray().
+    /// \return error code
+    ///
+    ///	The 'value' of a setting unknown to the config is NULL.
+    ///
+    enum ReturnedValue getSettings(struct Config const *config, char const * const *names, size_t count, struct Setting **settings);
+
+    ///
+    /// \brief enable or disable the cache of setting values of a config. Enabled by default.
+    /// \param config the config
+    /// \param enabled 0 to disable the cache, anything else to enable it
+    /// \return error code
+    ///
+    ///	While enabled, getSettingValue() and getSettingSize() only ask the service the first time a setting is read.
+    ///	The config then subscribes to the setting and cached values are dropped when a change is received,
+    ///	which happens during any call waiting for the service, pollRequests() or pollSubscriptions().
+    ///
+    enum ReturnedValue setSettingsCacheEnabled(struct Config *config, int enabled);
+
     ///
     /// \brief get the size of the setting's value
     /// \param config the config
@@ -252,10 +512,12 @@ namespace Albinos
     enum ReturnedValue getLocalSettings(struct Config const *config, struct Setting **settings, size_t *size);
 
     ///
-    /// \brief destroy a settings array obtained with getLocalSettings()
+    /// \brief destroy a settings array obtained with getLocalSettings() or getSettings()
     /// \param settings array to destroy
     /// \param size size of the 'settings' array
     ///
+    ///	The array and all its strings are a single allocation, they are all freed at once.
+    ///
     void destroySettingsArray(struct Setting *settings, size_t size);
 
     ///
@@ -313,15 +575,59 @@ namespace Albinos
     /// \param name setting you want to watch
     /// \param data point to userdata, which will be available in from the subscription in the callback
     /// \param onChange function pointer callback which will be called once for each setting change
-    /// \param subscription in case of success, a new 'struct Subscription' will be written
-    /// \return error code
+    /// \param subscription in case of success, a new 'struct Subscription' will be written, NULL otherwise
+    /// \return error code, LIMIT_EXCEEDED if the service refused the subscription
     ///
     ///	To stop the subscription, unsubscribe() must be called.\n
     ///	To get the subscription's user data one can use getSubscriptionUserData()\n
-    ///	To get the subscription's setting name one can use getSubscriptionSettingName()
+    ///	To get the subscription's setting name one can use getSubscriptionSettingName()\n
+    ///	If the service had to drop events this process didn't read in time, every subscription is called with UPDATE.
     ///
     enum ReturnedValue subscribeToSetting(struct Config *config, char const *name, void *data, FCPTR_ON_CHANGE_NOTIFIER onChange, struct Subscription **subscription);
 
+    ///
+    /// \brief get the setting's value without waiting for the answer
+    /// \param config the config
+    /// \param settingName setting name
+    /// \param data user data, available from the request with getRequestUserData()
+    /// \param onCompleted function called by pollRequests() when the answer is delivered, can be NULL
+    /// \param request if not NULL, a new 'struct Request' is written here. Must be released with releaseRequest().
+    /// \return error code
+    ///
+    ///	Once delivered, the value is available with getRequestValue()
+    ///
+    enum ReturnedValue getSettingValueAsync(struct Config *config, char const *settingName, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, struct Request **request);
+
+    ///
+    /// \brief add or modify a setting without waiting for the answer
+    /// \param config the config to add a setting to
+    /// \param name setting name
+    /// \param value new setting value
+    /// \param data user data, available from the request with getRequestUserData()
+    /// \param onCompleted function called by pollRequests() when the answer is delivered, can be NULL
+    /// \param request if not NULL, a new 'struct Request' is written here. Must be released with releaseRequest().
+    /// \return error code
+    ///
+    enum ReturnedValue setSettingAsync(struct Config *config, char const *name, char const *value, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, struct Request **request);
+
+    ///
+    /// \brief remove a setting without waiting for the answer
+    /// \param config the config to remove a setting from
+    /// \param name setting name
+    /// \param data user data, available from the request with getRequestUserData()
+    /// \param onCompleted function called by pollRequests() when the answer is delivered, can be NULL
+    /// \param request if not NULL, a new 'struct Request' is written here. Must be released with releaseRequest().
+    /// \return error code
+    ///
+    enum ReturnedValue removeSettingAsync(struct Config *config, char const *name, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, struct Request **request);
+
+    ///
+    /// \brief read the answers received so far without blocking, and deliver them to their requests
+    /// \param config the config
+    /// \return error code
+    ///
+    enum ReturnedValue pollRequests(struct Config *config);
+
     ///
     /// \brief call all callbacks for subscribed settings with updates
     /// \param config the config
@@ -329,6 +635,17 @@ namespace Albinos
     ///
     enum ReturnedValue pollSubscriptions(struct Config *config);
 
+    ///
+    /// \brief get a file descriptor which becomes readable when pollSubscriptions() has work to do
+    /// \param config the config
+    /// \param fd the file descriptor is written here. It belongs to the config and is closed by releaseConfig().
+    /// \return error code
+    ///
+    ///	It can be added to the application's main loop (epoll, GLib, Qt...) instead of calling pollSubscriptions()
+    ///	periodically. It must only be polled for reading, and stays readable until pollSubscriptions() is called.
+    ///
+    enum ReturnedValue getSubscriptionsFd(struct Config *config, int *fd);
+
     // Query functions:
 
     ///
@@ -1,117 +1,164 @@
+# include <unistd.h>
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+# include <cmath>
 # include "Config.hpp"
 
 ///
-/// \todo handle event
+/// run by a libuv callback, so a malformed event is ignored instead of throwing
 ///
-void Albinos::Config::parseResponse(json const &data)
+void Albinos::Config::parseEvent(json const &data)
 {
-  std::string status;
-
-  try {
-    status = data.at("REQUEST_STATE").get<std::string>();
-  } catch (...) {
-    // if the data received do not contain 'REQUEST_STATE', it's an event
-    ModifType modif;
-    std::string modifStr = data.at("SUBSCRIPTION_EVENT_TYPE").get<std::string>();
-    if (modifStr == "UPDATE")
-      modif = UPDATE;
-    else if (modifStr == "DELETE")
-      modif = DELETE;
-    else
-      throw LibError(INVALID_REPONSE_FROM_SERVICE);
-    settingsUpdates.push_back({data.at("SETTING_NAME").get<std::string>(), modif});
-    if (waitingForResponse)
-      socketLoop->run<uvw::Loop::Mode::ONCE>();
+  auto type = data.find("SUBSCRIPTION_EVENT_TYPE");
+  auto name = data.find("SETTING_NAME");
+  if (type == data.end() || !type->is_string() || name == data.end() || !name->is_string())
     return;
-  }
-
-  try {
-    lastRequestedValue = data.at("SETTING_VALUE").get<std::string>();
+  ModifType modif;
+  if (*type == "UPDATE")
+    modif = UPDATE;
+  else if (*type == "DELETE")
+    modif = DELETE;
+  else
     return;
-  } catch (...) {
-    lastRequestedValue = "";
+  std::string settingName = name->get<std::string>();
+  std::lock_guard<std::mutex> lock(mutex);
+  settingsCache.erase(settingName);
+  ++cacheGeneration;
+  // events for settings only watched by the cache have no user callback
+  if (settingsSubscriptions.count(settingName)) {
+    settingsUpdates.push_back({std::move(settingName), modif});
+    signalEvents();
   }
+}
 
-  try {
-    depsIds = data.at("DEPS").get<std::vector<uint32_t>>();
-    return;
-  } catch (...) {
-    lastRequestedValue.clear();
-  }
+///
+/// Any setting may have changed without notice: nothing cached can be trusted anymore,
+/// and every subscription is told its setting was updated so that it reads it again
+///
+void Albinos::Config::onEventsDropped()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  settingsCache.clear();
+  ++cacheGeneration;
+  for (auto const &[settingName, subscription] : settingsSubscriptions)
+    settingsUpdates.push_back({settingName, UPDATE});
+  if (!settingsSubscriptions.empty())
+    signalEvents();
+}
 
-  try {
-    name = data.at("CONFIG_NAME").get<std::string>();
-    configId = data.at("CONFIG_ID").get<uint32_t>();
-    return;
-  } catch (...) {
+///
+/// wait for the answer, at most the connection timeout.
+/// Answers to asynchronous requests received meanwhile are kept until pollRequests()
+/// \return the answer, a null json if it didn't come
+///
+Albinos::Config::json Albinos::Config::sendJson(const json& data) const
+{
+  json request = data;
+
+  return connection->request(request);
+}
+
+void Albinos::Config::sendJsonAsync(const json& data, ResponseType type, Request *request) const
+{
+  json requestData = data;
+  uint64_t requestId = connection->newRequestId();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pendingRequests.emplace(requestId, request);
   }
+  connection->send(requestId, requestData, [this, type, request](uint64_t id, json const &answer) {
+    onAnswer(request, type, id, answer);
+  });
+}
 
-  try {
-    std::string keyStr = data.at("CONFIG_KEY").get<std::string>();
-    std::string roKeyStr = data.at("READONLY_CONFIG_KEY").get<std::string>();
-    key.emplace(keyStr, READ_WRITE);
-    roKey.emplace(roKeyStr, READ_ONLY);
+void Albinos::Config::sendJsonNoWait(const json& data) const
+{
+  json requestData = data;
+
+  connection->send(connection->newRequestId(), requestData, [](uint64_t, json const &) {});
+}
+
+void Albinos::Config::onAnswer(Request *request, ResponseType type, uint64_t requestId, json const &answer) const
+{
+  Response response(type, answer);
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // already failed by failPendingRequests()
+  if (!pendingRequests.erase(requestId))
     return;
-  } catch (...) {
+  if (response.getResult() == SUCCESS && type == ResponseType::SETTING_VALUE)
+    request->complete(SUCCESS, SettingValue::toString(response["SETTING_VALUE"]));
+  else
+    request->complete(response.getResult());
+  receivedRequests.push_back(request);
+}
+
+Albinos::Request *Albinos::Config::newRequest(FCPTR_ON_REQUEST_COMPLETED onCompleted, void *data, Request **request) const
+{
+  Request *newRequest = new Request(onCompleted, data);
+
+  // without a handle for the user, the request frees itself once delivered
+  if (request)
+    *request = newRequest;
+  else
+    newRequest->release();
+  return newRequest;
+}
+
+void Albinos::Config::failPendingRequests(ReturnedValue error)
+{
+  std::unordered_map<uint64_t, Request *> pending;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.swap(pendingRequests);
+  }
+  // once this ran on the loop's thread, none of their handlers can run anymore
+  connection->executeAndWait([this, &pending]() {
+    for (auto const &entry : pending)
+      connection->cancel(entry.first);
+  });
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &[requestId, request] : pending) {
+    request->complete(error);
+    receivedRequests.push_back(request);
   }
+}
 
-  try {
-    settingNames.reset(new std::vector<std::string>(std::move(data.at("SETTINGS_NAMES").get<std::vector<std::string>>())));
+void Albinos::Config::deliverRequests()
+{
+  std::vector<Request *> received;
 
-    return;
-  } catch (...) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    received.swap(receivedRequests);
   }
+  for (Request *request : received)
+    if (request->deliver())
+      delete request;
 }
 
 ///
-/// \todo better error management
+/// must be called with the lock held
 ///
-void Albinos::Config::initSocket()
+void Albinos::Config::signalEvents() const
 {
-  std::string socketPath = (std::filesystem::temp_directory_path() / "raven-os_service_albinos.sock").string();
+  uint64_t one = 1;
 
-  socket->on<uvw::ErrorEvent>([this](const uvw::ErrorEvent&e, uvw::PipeHandle&) {
-    std::cout << "Error" << std::endl;
-    switch (e.code()) {
-      /// \todo catch relevant value from libuv http://docs.libuv.org/en/v1.x/errors.html
-    default:
-      irrecoverable = UNKNOWN;
-    }
-  });
-  socket->once<uvw::ConnectEvent>([](const uvw::ConnectEvent&, uvw::PipeHandle&) {
-    //std::cout << "All succeed" << std::endl;
-  });
-  socket->on<uvw::DataEvent>([this](const uvw::DataEvent &dataEvent, uvw::PipeHandle &) {
-    std::string response = std::string(dataEvent.data.get(), dataEvent.length);
-    //std::cout << "Data received" << std::endl;
-    //std::cout << response << std::endl;
-    parseResponse(json::parse(response));
-  });
-  socket->on<uvw::WriteEvent>([this](const uvw::WriteEvent &, uvw::PipeHandle &sock) {
-    //std::cout << "Data sent" << std::endl;
-    sock.read();
-    // if the service doesn't respond after 200ms, stop the loop
-    timer->start(writeTimeout, std::chrono::duration<uint64_t, std::milli>(1000));
-    waitingForResponse = true;
-    socketLoop->run<uvw::Loop::Mode::ONCE>();
-    waitingForResponse = false;
-  });
-  timer->on<uvw::TimerEvent>([this](const uvw::TimerEvent&, uvw::TimerHandle &handle) {
-    //std::cout << "Timeout" << std::endl;
-    socketLoop->stop();
-    handle.stop();
-  });
-  //std::cout << "Trying to connect to " << socketPath << std::endl;
-  socket->connect(socketPath);
-  socketLoop->run<uvw::Loop::Mode::ONCE>();
+  if (eventsFd != -1)
+    (void)::write(eventsFd, &one, sizeof(one));
 }
 
-void Albinos::Config::sendJson(const json& data) const
+///
+/// must be called with the lock held
+///
+void Albinos::Config::clearEvents() const
 {
-  std::string requestStr = data.dump();
+  uint64_t count;
 
-  socket->write(requestStr.data(), requestStr.size());
-  socketLoop->run<uvw::Loop::Mode::ONCE>();
+  if (eventsFd != -1)
+    (void)::read(eventsFd, &count, sizeof(count));
 }
 
 void Albinos::Config::loadConfig(KeyWrapper const &givenKey)
@@ -134,36 +181,206 @@ void Albinos::Config::loadConfig(KeyWrapper const &givenKey)
   default:
     assert(false); // unknow key type
   }
-  sendJson(request);
+  json answer = sendJson(request);
+  Response response(ResponseType::CONFIG_INFO, answer);
+  if (response.getResult() != SUCCESS)
+    throw LibError(response.getResult());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    name = response["CONFIG_NAME"].get<std::string>();
+    configId = response["CONFIG_ID"].get<uint32_t>();
+  }
+  loaded = true;
+  connection->execute([this]() {
+    connection->registerConfig(configId, this);
+  });
+}
+
+///
+/// \return the value of the setting, with its type, nullopt if the service doesn't know it.
+/// Only the first read of a setting reaches the service while the cache is enabled.
+///
+std::optional<Albinos::Config::json> Albinos::Config::fetchSettingValue(char const *settingName) const
+{
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cacheEnabled) {
+      auto cached = settingsCache.find(settingName);
+      if (cached != settingsCache.end())
+        return cached->second;
+    }
+    generation = cacheGeneration;
+  }
+  watchForCache(settingName);
+
+  json request;
+  request["REQUEST_NAME"] = "SETTING_GET";
+  request["CONFIG_ID"] = configId;
+  request["SETTING_NAME"] = settingName;
+  json answer = sendJson(request);
+  Response response(ResponseType::SETTING_VALUE, answer);
+  if (response.getResult() != SUCCESS)
+    return std::nullopt;
+
+  json const &value = response["SETTING_VALUE"];
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cacheEnabled && generation == cacheGeneration && isWatched(settingName))
+    settingsCache[settingName] = value;
+  return value;
+}
+
+Albinos::ReturnedValue Albinos::Config::fetchTypedValue(char const *settingName, json &value) const
+{
+  std::optional<json> settingValue = fetchSettingValue(settingName);
+
+  if (!settingValue)
+    return connection->getError().value_or(UNKNOWN_SETTING);
+  value = std::move(*settingValue);
+  return SUCCESS;
+}
+
+///
+/// subscribe to a setting before reading it, so every change after the value we get is notified.
+/// The answer comes before the one to the read that follows, so the value is only cached once
+/// the service accepted the subscription.
+///
+void Albinos::Config::watchForCache(char const *settingName) const
+{
+  uint64_t requestId = connection->newRequestId();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cacheEnabled || settingsSubscriptions.count(settingName)
+        || !cacheSubscriptions.emplace(settingName, requestId).second)
+      return;
+  }
+  json request;
+  request["REQUEST_NAME"] = "SUBSCRIBE_SETTING";
+  request["CONFIG_ID"] = configId;
+  request["SETTING_NAME"] = settingName;
+  connection->send(requestId, request, [this, name = std::string(settingName)](uint64_t id, json const &answer) {
+    onCacheSubscription(name, id, answer);
+  });
+}
+
+///
+/// a refused subscription leaves the setting out of the cache, its next read tries again
+///
+void Albinos::Config::onCacheSubscription(std::string const &settingName, uint64_t requestId, json const &answer) const
+{
+  ReturnedValue result = Response(ResponseType::STATE, answer).getResult();
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto watched = cacheSubscriptions.find(settingName);
+  if (watched == cacheSubscriptions.end() || watched->second != requestId)
+    return;
+  if (result == SUCCESS) {
+    watched->second = 0;
+    return;
+  }
+  cacheSubscriptions.erase(watched);
+  settingsCache.erase(settingName);
+  ++cacheGeneration;
+}
+
+///
+/// must be called with the lock held
+/// \return whether the service notifies the changes of the setting, so that its value can be cached
+///
+bool Albinos::Config::isWatched(std::string const &settingName) const
+{
+  auto watched = cacheSubscriptions.find(settingName);
+
+  return settingsSubscriptions.count(settingName) || (watched != cacheSubscriptions.end() && watched->second == 0);
+}
+
+///
+/// forget the SUBSCRIBE_SETTING still waiting for their answer, whose handlers use this config
+///
+void Albinos::Config::cancelCacheSubscriptions() const
+{
+  std::vector<uint64_t> pending;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto const &[settingName, requestId] : cacheSubscriptions)
+      if (requestId)
+        pending.push_back(requestId);
+  }
+  if (pending.empty())
+    return;
+  connection->executeAndWait([this, &pending]() {
+    for (uint64_t requestId : pending)
+      connection->cancel(requestId);
+  });
+}
+
+void Albinos::Config::invalidateCache(std::string const &settingName) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  settingsCache.erase(settingName);
+  ++cacheGeneration;
+}
+
+///
+/// \brief build a settings array and all its strings in a single allocation, released by destroySettingsArray()
+/// \param settings names and values, a missing value gives a NULL 'value'
+///
+Albinos::Setting *Albinos::Config::allocateSettings(std::vector<std::pair<std::string, std::optional<std::string>>> const &settings)
+{
+  size_t blockSize = settings.size() * sizeof(Setting);
+  for (auto const &[name, value] : settings)
+    blockSize += name.size() + 1 + (value ? value->size() + 1 : 0);
+
+  char *block = new char[blockSize];
+  char *strings = block + settings.size() * sizeof(Setting);
+  auto copyString = [&strings](std::string const &str) noexcept
+    {
+      char *copy = strings;
+      std::memcpy(copy, str.c_str(), str.size() + 1);
+      strings += str.size() + 1;
+      return copy;
+    };
+
+  Setting *result = reinterpret_cast<Setting *>(block);
+  for (size_t i = 0 ; i < settings.size() ; ++i) {
+    char *name = copyString(settings[i].first);
+    char *value = settings[i].second ? copyString(*settings[i].second) : nullptr;
+    new (&result[i]) Setting{value, name};
+  }
+  return result;
 }
 
 Albinos::Config::Config(std::string const &name)
   : name(name)
 {
-  initSocket();
+  if (auto error = connection->getError())
+    throw LibError(*error);
   json request;
   request["CONFIG_NAME"] = name;
   request["REQUEST_NAME"] = "CONFIG_CREATE";
-  sendJson(request);
-  if (irrecoverable.has_value())
-    throw LibError(*irrecoverable);
-  loadConfig(*key);
-  if (irrecoverable.has_value())
-    throw LibError(*irrecoverable);
+  json answer = sendJson(request);
+  Response response(ResponseType::CONFIG_KEYS, answer);
+  if (response.getResult() != SUCCESS)
+    throw LibError(connection->getError().value_or(response.getResult()));
+  roKey.emplace(response["READONLY_CONFIG_KEY"].get<std::string>(), READ_ONLY);
+  loadConfig(KeyWrapper(response["CONFIG_KEY"].get<std::string>(), READ_WRITE));
 }
 
 Albinos::Config::Config(Key const &givenKey)
 {
-  initSocket();
+  if (auto error = connection->getError())
+    throw LibError(*error);
   loadConfig(givenKey);
-  if (irrecoverable.has_value())
-    throw LibError(*irrecoverable);
 }
 
 Albinos::Config::Config(uint32_t configId)
   : configId(configId)
 {
-  initSocket();
+  connection->execute([this]() {
+    connection->registerConfig(this->configId, this);
+  });
 }
 
 Albinos::Config::~Config()
@@ -171,14 +388,25 @@ Albinos::Config::~Config()
   json request;
   request["REQUEST_NAME"] = "CONFIG_UNLOAD";
   request["CONFIG_ID"] = configId;
-  sendJson(request);
-  socket->close();
+  // a dependency does not own its id, the config that loaded it does
+  if (loaded && !connection->getError())
+    sendJson(request);
+  connection->executeAndWait([this]() {
+    connection->unregisterConfig(configId, this);
+  });
+  cancelCacheSubscriptions();
+  failPendingRequests(CONNECTION_ERROR);
+  deliverRequests();
+  if (subscriptionsPollFd != -1)
+    ::close(subscriptionsPollFd);
+  if (eventsFd != -1)
+    ::close(eventsFd);
 }
 
 Albinos::ReturnedValue Albinos::Config::getKey(Key *configKey) const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   if (!key)
     return KEY_NOT_INITIALIZED;
   key->dupKey(*configKey);
@@ -187,8 +415,8 @@ Albinos::ReturnedValue Albinos::Config::getKey(Key *configKey) const
 
 Albinos::ReturnedValue Albinos::Config::getReadOnlyKey(Key *configKey) const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   if (!roKey)
     return KEY_NOT_INITIALIZED;
   roKey->dupKey(*configKey);
@@ -200,14 +428,13 @@ Albinos::ReturnedValue Albinos::Config::getReadOnlyKey(Key *configKey) const
 ///
 Albinos::ReturnedValue Albinos::Config::getSettingValue(char const *settingName, char *value, size_t valueSize) const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
-  json request;
-  request["REQUEST_NAME"] = "SETTING_GET";
-  request["CONFIG_ID"] = configId;
-  request["SETTING_NAME"] = settingName;
-  sendJson(request);
-  std::memcpy(value, lastRequestedValue.c_str(), std::min(valueSize, lastRequestedValue.length()));
+  if (auto error = connection->getError())
+    return *error;
+  std::optional<json> settingValue = fetchSettingValue(settingName);
+  if (settingValue) {
+    std::string str = SettingValue::toString(*settingValue);
+    std::memcpy(value, str.c_str(), std::min(valueSize, str.length()));
+  }
   return SUCCESS;
 }
 
@@ -216,30 +443,187 @@ Albinos::ReturnedValue Albinos::Config::getSettingValue(char const *settingName,
 ///
 Albinos::ReturnedValue Albinos::Config::getSettingSize(char const *settingName, size_t *size) const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
-  json request;
-  request["REQUEST_NAME"] = "SETTING_GET";
-  request["CONFIG_ID"] = configId;
-  request["SETTING_NAME"] = settingName;
-  sendJson(request);
-  *size = lastRequestedValue.length();
+  if (auto error = connection->getError())
+    return *error;
+  std::optional<json> settingValue = fetchSettingValue(settingName);
+  *size = settingValue ? SettingValue::toString(*settingValue).length() : 0;
+  return SUCCESS;
+}
+
+Albinos::ReturnedValue Albinos::Config::getSettingType(char const *settingName, SettingType *type) const
+{
+  if (auto error = connection->getError())
+    return *error;
+  json value;
+  if (ReturnedValue result = fetchTypedValue(settingName, value); result != SUCCESS)
+    return result;
+  std::optional<SettingType> settingType = SettingValue::getType(value);
+  if (!settingType)
+    return INVALID_REPONSE_FROM_SERVICE;
+  *type = *settingType;
+  return SUCCESS;
+}
+
+Albinos::ReturnedValue Albinos::Config::getSettingInt(char const *settingName, int64_t *value) const
+{
+  if (auto error = connection->getError())
+    return *error;
+  json settingValue;
+  if (ReturnedValue result = fetchTypedValue(settingName, settingValue); result != SUCCESS)
+    return result;
+  if (!settingValue.is_number_integer()
+      || (settingValue.is_number_unsigned() && settingValue.get<uint64_t>() > static_cast<uint64_t>(INT64_MAX)))
+    return WRONG_SETTING_TYPE;
+  *value = settingValue.get<int64_t>();
+  return SUCCESS;
+}
+
+Albinos::ReturnedValue Albinos::Config::getSettingDouble(char const *settingName, double *value) const
+{
+  if (auto error = connection->getError())
+    return *error;
+  json settingValue;
+  if (ReturnedValue result = fetchTypedValue(settingName, settingValue); result != SUCCESS)
+    return result;
+  if (!settingValue.is_number())
+    return WRONG_SETTING_TYPE;
+  *value = settingValue.get<double>();
+  return SUCCESS;
+}
+
+Albinos::ReturnedValue Albinos::Config::getSettingBool(char const *settingName, bool *value) const
+{
+  if (auto error = connection->getError())
+    return *error;
+  json settingValue;
+  if (ReturnedValue result = fetchTypedValue(settingName, settingValue); result != SUCCESS)
+    return result;
+  if (!settingValue.is_boolean())
+    return WRONG_SETTING_TYPE;
+  *value = settingValue.get<bool>();
+  return SUCCESS;
+}
+
+Albinos::ReturnedValue Albinos::Config::getSettingBlob(char const *settingName, void *data, size_t size) const
+{
+  if (auto error = connection->getError())
+    return *error;
+  json settingValue;
+  if (ReturnedValue result = fetchTypedValue(settingName, settingValue); result != SUCCESS)
+    return result;
+  std::optional<std::string> blob = SettingValue::toBlob(settingValue);
+  if (!blob)
+    return WRONG_SETTING_TYPE;
+  std::memcpy(data, blob->data(), std::min(size, blob->size()));
   return SUCCESS;
 }
 
 ///
-/// \todo handle error
+/// Cached values are used, the others are asked in a single SETTINGS_GET
 ///
-Albinos::ReturnedValue Albinos::Config::setSetting(char const *name, char const *value)
+Albinos::ReturnedValue Albinos::Config::getSettings(char const * const *names, size_t count, Setting **settings) const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
+  std::vector<std::pair<std::string, std::optional<std::string>>> result;
+  std::vector<std::string> missing;
+  uint64_t generation;
+
+  result.reserve(count);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0 ; i < count ; ++i) {
+      result.emplace_back(names[i], std::nullopt);
+      auto cached = settingsCache.find(names[i]);
+      if (cacheEnabled && cached != settingsCache.end())
+        result.back().second = SettingValue::toString(cached->second);
+      else
+        missing.push_back(names[i]);
+    }
+    generation = cacheGeneration;
+  }
+
+  if (!missing.empty()) {
+    for (std::string const &name : missing)
+      watchForCache(name.c_str());
+    json request;
+    request["REQUEST_NAME"] = "SETTINGS_GET";
+    request["CONFIG_ID"] = configId;
+    request["SETTINGS_NAMES"] = missing;
+    json answer = sendJson(request);
+    Response response(ResponseType::SETTINGS, answer);
+    if (response.getResult() != SUCCESS)
+      return connection->getError().value_or(REQUEST_FAILED);
+    json const &received = response["SETTINGS"];
+
+    std::lock_guard<std::mutex> lock(mutex);
+    bool cacheable = cacheEnabled && generation == cacheGeneration;
+    for (auto &[name, value] : result) {
+      if (value)
+        continue;
+      auto receivedValue = received.find(name);
+      if (receivedValue == received.end())
+        continue;
+      value = SettingValue::toString(*receivedValue);
+      if (cacheable && isWatched(name))
+        settingsCache[name] = *receivedValue;
+    }
+  }
+
+  *settings = allocateSettings(result);
+  return SUCCESS;
+}
+
+///
+/// The typed setters all go through here, a value the service refuses gives REQUEST_FAILED
+///
+Albinos::ReturnedValue Albinos::Config::setSettingValue(char const *name, json const &value)
+{
+  if (auto error = connection->getError())
+    return *error;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (updating) {
+      updatedSettings[name] = value;
+      removedSettings.erase(name);
+      return SUCCESS;
+    }
+  }
   json request;
   request["REQUEST_NAME"] = "SETTING_UPDATE";
   request["CONFIG_ID"] = configId;
   request["SETTINGS_TO_UPDATE"][name] = value;
-  sendJson(request);
-  return SUCCESS;
+  invalidateCache(name);
+  json answer = sendJson(request);
+  return connection->getError().value_or(Response(ResponseType::STATE, answer).getResult());
+}
+
+Albinos::ReturnedValue Albinos::Config::setSetting(char const *name, char const *value)
+{
+  return setSettingValue(name, value);
+}
+
+Albinos::ReturnedValue Albinos::Config::setSettingInt(char const *name, int64_t value)
+{
+  return setSettingValue(name, value);
+}
+
+Albinos::ReturnedValue Albinos::Config::setSettingDouble(char const *name, double value)
+{
+  // json has no representation for them
+  if (!std::isfinite(value))
+    return BAD_PARAMETERS;
+  return setSettingValue(name, value);
+}
+
+Albinos::ReturnedValue Albinos::Config::setSettingBool(char const *name, bool value)
+{
+  return setSettingValue(name, value);
+}
+
+Albinos::ReturnedValue Albinos::Config::setSettingBlob(char const *name, void const *data, size_t size)
+{
+  return setSettingValue(name, SettingValue::fromBlob(data, size));
 }
 
 ///
@@ -247,8 +631,8 @@ Albinos::ReturnedValue Albinos::Config::setSetting(char const *name, char const
 ///
 Albinos::ReturnedValue Albinos::Config::setSettingAlias(char const *name, char const *aliasName)
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   json request;
   request["REQUEST_NAME"] = "ALIAS_SET";
   request["CONFIG_ID"] = configId;
@@ -263,8 +647,8 @@ Albinos::ReturnedValue Albinos::Config::setSettingAlias(char const *name, char c
 ///
 Albinos::ReturnedValue Albinos::Config::unsetAlias(char const *aliasName)
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   json request;
   request["REQUEST_NAME"] = "ALIAS_UNSET";
   request["ALIAS_NAME"] = aliasName;
@@ -273,16 +657,106 @@ Albinos::ReturnedValue Albinos::Config::unsetAlias(char const *aliasName)
 }
 
 ///
-/// \todo handle error
+/// UNKNOWN_SETTING if the config doesn't have it
 ///
 Albinos::ReturnedValue Albinos::Config::removeSetting(char const *name)
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (updating) {
+      updatedSettings.erase(name);
+      removedSettings.insert(name);
+      return SUCCESS;
+    }
+  }
   json request;
   request["REQUEST_NAME"] = "SETTING_REMOVE";
+  request["CONFIG_ID"] = configId;
   request["SETTING_NAME"] = name;
-  sendJson(request);
+  invalidateCache(name);
+  json answer = sendJson(request);
+  return connection->getError().value_or(Response(ResponseType::STATE, answer).getResult());
+}
+
+///
+/// UNKNOWN_SETTING if one of them is missing, then nothing is removed
+///
+Albinos::ReturnedValue Albinos::Config::removeSettings(char const * const *names, size_t count)
+{
+  if (auto error = connection->getError())
+    return *error;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (updating) {
+      for (size_t i = 0 ; i < count ; ++i) {
+        updatedSettings.erase(names[i]);
+        removedSettings.insert(names[i]);
+      }
+      return SUCCESS;
+    }
+  }
+  json request;
+  request["REQUEST_NAME"] = "SETTINGS_REMOVE";
+  request["CONFIG_ID"] = configId;
+  request["SETTINGS_NAMES"] = std::vector<std::string>(names, names + count);
+  for (size_t i = 0 ; i < count ; ++i)
+    invalidateCache(names[i]);
+  json answer = sendJson(request);
+  return connection->getError().value_or(Response(ResponseType::STATE, answer).getResult());
+}
+
+Albinos::ReturnedValue Albinos::Config::beginUpdate()
+{
+  if (auto error = connection->getError())
+    return *error;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (updating)
+    return UPDATE_IN_PROGRESS;
+  updating = true;
+  return SUCCESS;
+}
+
+///
+/// All the buffered changes go in one SETTING_UPDATE, applied by the service with a single write
+///
+Albinos::ReturnedValue Albinos::Config::commitUpdate()
+{
+  json request;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!updating)
+      return NO_UPDATE_IN_PROGRESS;
+    updating = false;
+    if (updatedSettings.empty() && removedSettings.empty())
+      return SUCCESS;
+    request["SETTINGS_TO_UPDATE"] = std::move(updatedSettings);
+    request["SETTINGS_TO_REMOVE"] = std::vector<std::string>(removedSettings.begin(), removedSettings.end());
+    updatedSettings = json::object();
+    removedSettings.clear();
+  }
+  if (auto error = connection->getError())
+    return *error;
+  request["REQUEST_NAME"] = "SETTING_UPDATE";
+  request["CONFIG_ID"] = configId;
+  for (auto const &[name, value] : request["SETTINGS_TO_UPDATE"].items())
+    invalidateCache(name);
+  for (json const &name : request["SETTINGS_TO_REMOVE"])
+    invalidateCache(name.get_ref<std::string const &>());
+  json answer = sendJson(request);
+  return Response(ResponseType::STATE, answer).getResult();
+}
+
+Albinos::ReturnedValue Albinos::Config::cancelUpdate()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (!updating)
+    return NO_UPDATE_IN_PROGRESS;
+  updating = false;
+  updatedSettings = json::object();
+  removedSettings.clear();
   return SUCCESS;
 }
 
@@ -291,8 +765,8 @@ Albinos::ReturnedValue Albinos::Config::removeSetting(char const *name)
 ///
 Albinos::ReturnedValue Albinos::Config::include(Key *inheritFrom, int position)
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   (void)inheritFrom;
   (void)position;
   return SUCCESS;
@@ -303,28 +777,44 @@ Albinos::ReturnedValue Albinos::Config::include(Key *inheritFrom, int position)
 ///
 Albinos::ReturnedValue Albinos::Config::uninclude(Key *inheritFrom, int position)
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   (void)inheritFrom;
   (void)position;
   return SUCCESS;
 }
 
 ///
-/// \todo get errors
+/// A subscription the service refuses is not kept, its setting is not cached either
 ///
 Albinos::ReturnedValue Albinos::Config::subscribeToSetting(char const *settingName, void *data, FCPTR_ON_CHANGE_NOTIFIER onChange, Subscription **subscription)
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   json request;
   *subscription = new Subscription(settingName, onChange, data);
-  settingsSubscriptions[settingName] = *subscription;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    settingsSubscriptions[settingName] = *subscription;
+  }
   request["REQUEST_NAME"] = "SUBSCRIBE_SETTING";
   request["CONFIG_ID"] = configId;
   request["SETTING_NAME"] = settingName;
-  sendJson(request);
-  return SUCCESS;
+  json answer = sendJson(request);
+  ReturnedValue result = Response(ResponseType::STATE, answer).getResult();
+  if (result == SUCCESS)
+    return SUCCESS;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto subscribed = settingsSubscriptions.find(settingName);
+    if (subscribed != settingsSubscriptions.end() && subscribed->second == *subscription)
+      settingsSubscriptions.erase(subscribed);
+    if (!cacheSubscriptions.count(settingName) || cacheSubscriptions.at(settingName) != 0)
+      settingsCache.erase(settingName);
+  }
+  delete *subscription;
+  *subscription = nullptr;
+  return connection->getError().value_or(result);
 }
 
 ///
@@ -332,11 +822,15 @@ Albinos::ReturnedValue Albinos::Config::subscribeToSetting(char const *settingNa
 ///
 Albinos::ReturnedValue Albinos::Config::getDependencies(Config ***deps, size_t *size) const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   json request;
   request["REQUEST_NAME"] = "CONFIG_GET_DEPS";
-  sendJson(request);
+  json answer = sendJson(request);
+  Response response(ResponseType::DEPS, answer);
+  std::vector<uint32_t> depsIds;
+  if (response.getResult() == SUCCESS)
+    depsIds = response["DEPS"].get<std::vector<uint32_t>>();
   *size = depsIds.size();
   *deps = new Config* [*size];
   for (unsigned i = 0 ; i < *size ; ++i)
@@ -344,15 +838,25 @@ Albinos::ReturnedValue Albinos::Config::getDependencies(Config ***deps, size_t *
   return SUCCESS;
 }
 
-///
-/// \todo implementation
-///
 Albinos::ReturnedValue Albinos::Config::getLocalSettings(Setting **settings, size_t *size) const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
-  (void)settings;
-  (void)size;
+  if (auto error = connection->getError())
+    return *error;
+  json request;
+  request["REQUEST_NAME"] = "CONFIG_GET_SETTINGS";
+  request["CONFIG_ID"] = configId;
+  json answer = sendJson(request);
+  Response response(ResponseType::SETTINGS, answer);
+  if (response.getResult() != SUCCESS)
+    return connection->getError().value_or(REQUEST_FAILED);
+  json const &received = response["SETTINGS"];
+
+  std::vector<std::pair<std::string, std::optional<std::string>>> result;
+  result.reserve(received.size());
+  for (auto const &[name, value] : received.items())
+    result.emplace_back(name, SettingValue::toString(value));
+  *size = result.size();
+  *settings = allocateSettings(result);
   return SUCCESS;
 }
 
@@ -361,14 +865,18 @@ Albinos::ReturnedValue Albinos::Config::getLocalSettings(Setting **settings, siz
 ///
 Albinos::ReturnedValue Albinos::Config::getLocalSettingsNames(char const * const **names, size_t *size) const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
-  (void)names;
+  if (auto error = connection->getError())
+    return *error;
   json request;
-  request["REQUEST_NAME"] = "GET_SETTINGS_NAMES";
+  request["REQUEST_NAME"] = "CONFIG_GET_SETTINGS_NAMES";
   request["CONFIG_ID"] = configId;
-  sendJson(request);
+  json answer = sendJson(request);
+  Response response(ResponseType::SETTINGS_NAMES, answer);
+  if (response.getResult() != SUCCESS)
+    return connection->getError().value_or(REQUEST_FAILED);
 
+  std::lock_guard<std::mutex> lock(mutex);
+  settingNames.reset(new std::vector<std::string>(response["SETTINGS_NAMES"].get<std::vector<std::string>>()));
   auto result = new char const *[settingNames->size() + 1];
   std::transform(settingNames->begin(), settingNames->end(), result,
 		 [](std::string const &str) noexcept
@@ -387,8 +895,8 @@ Albinos::ReturnedValue Albinos::Config::getLocalSettingsNames(char const * const
 ///
 Albinos::ReturnedValue Albinos::Config::getLocalAliases(Alias **aliases, size_t *size) const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   (void)aliases;
   (void)size;
   return SUCCESS;
@@ -399,8 +907,8 @@ Albinos::ReturnedValue Albinos::Config::getLocalAliases(Alias **aliases, size_t
 ///
 Albinos::ReturnedValue Albinos::Config::deleteConfig() const
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
+  if (auto error = connection->getError())
+    return *error;
   json request;
   request["REQUEST_NAME"] = "CONFIG_DESTROY";
   request["CONFIG_ID"] = configId;
@@ -413,12 +921,139 @@ Albinos::ReturnedValue Albinos::Config::deleteConfig() const
 ///
 Albinos::ReturnedValue Albinos::Config::pollSubscriptions()
 {
-  if (irrecoverable.has_value())
-    return *irrecoverable;
-  while (socketLoop->run<uvw::Loop::Mode::NOWAIT>());
-  while (!settingsUpdates.empty()) {
-    settingsSubscriptions.at(settingsUpdates.back().name)->executeCallBack(settingsUpdates.back().modif);
-    settingsUpdates.pop_back();
+  if (auto error = connection->getError())
+    return *error;
+  connection->poll();
+
+  // callbacks are called without the lock, they may use the config
+  std::vector<std::pair<Subscription *, ModifType>> updates;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    clearEvents();
+    while (!settingsUpdates.empty()) {
+      updates.emplace_back(settingsSubscriptions.at(settingsUpdates.back().name), settingsUpdates.back().modif);
+      settingsUpdates.pop_back();
+    }
+  }
+  for (auto const &[subscription, modif] : updates)
+    subscription->executeCallBack(modif);
+  return SUCCESS;
+}
+
+///
+/// The fd is created on the first call and lives as long as the config
+///
+Albinos::ReturnedValue Albinos::Config::getSubscriptionsFd(int *fd)
+{
+  if (auto error = connection->getError())
+    return *error;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (eventsFd == -1) {
+    eventsFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventsFd == -1)
+      return UNKNOWN;
+    if (!settingsUpdates.empty())
+      signalEvents();
+  }
+  if (connection->hasIoThread()) {
+    *fd = eventsFd;
+    return SUCCESS;
+  }
+
+  // the events are only read from the socket when the loop runs, which pollSubscriptions() does
+  if (subscriptionsPollFd == -1) {
+    subscriptionsPollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (subscriptionsPollFd == -1)
+      return UNKNOWN;
+    epoll_event watched{};
+    watched.events = EPOLLIN;
+    for (int watchedFd : {eventsFd, connection->getLoopFd()}) {
+      watched.data.fd = watchedFd;
+      if (epoll_ctl(subscriptionsPollFd, EPOLL_CTL_ADD, watchedFd, &watched) == -1) {
+        ::close(subscriptionsPollFd);
+        subscriptionsPollFd = -1;
+        return UNKNOWN;
+      }
+    }
+  }
+  *fd = subscriptionsPollFd;
+  return SUCCESS;
+}
+
+Albinos::ReturnedValue Albinos::Config::getSettingValueAsync(char const *settingName, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, Request **request)
+{
+  if (auto error = connection->getError())
+    return *error;
+  json requestData;
+  requestData["REQUEST_NAME"] = "SETTING_GET";
+  requestData["CONFIG_ID"] = configId;
+  requestData["SETTING_NAME"] = settingName;
+  sendJsonAsync(requestData, ResponseType::SETTING_VALUE, newRequest(onCompleted, data, request));
+  return SUCCESS;
+}
+
+Albinos::ReturnedValue Albinos::Config::setSettingAsync(char const *name, char const *value, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, Request **request)
+{
+  if (auto error = connection->getError())
+    return *error;
+  json requestData;
+  requestData["REQUEST_NAME"] = "SETTING_UPDATE";
+  requestData["CONFIG_ID"] = configId;
+  requestData["SETTINGS_TO_UPDATE"][name] = value;
+  invalidateCache(name);
+  sendJsonAsync(requestData, ResponseType::STATE, newRequest(onCompleted, data, request));
+  return SUCCESS;
+}
+
+Albinos::ReturnedValue Albinos::Config::removeSettingAsync(char const *name, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, Request **request)
+{
+  if (auto error = connection->getError())
+    return *error;
+  json requestData;
+  requestData["REQUEST_NAME"] = "SETTING_REMOVE";
+  requestData["CONFIG_ID"] = configId;
+  requestData["SETTING_NAME"] = name;
+  invalidateCache(name);
+  sendJsonAsync(requestData, ResponseType::STATE, newRequest(onCompleted, data, request));
+  return SUCCESS;
+}
+
+///
+/// \todo error management
+///
+Albinos::ReturnedValue Albinos::Config::pollRequests()
+{
+  connection->poll();
+  deliverRequests();
+  return connection->getError().value_or(SUCCESS);
+}
+
+Albinos::ReturnedValue Albinos::Config::setSettingsCacheEnabled(bool enabled)
+{
+  if (auto error = connection->getError())
+    return *error;
+  std::vector<std::string> unwatched;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    cacheEnabled = enabled;
+    if (enabled)
+      return SUCCESS;
+  }
+  cancelCacheSubscriptions();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    settingsCache.clear();
+    for (auto const &[settingName, requestId] : cacheSubscriptions)
+      if (!settingsSubscriptions.count(settingName))
+        unwatched.push_back(settingName);
+    cacheSubscriptions.clear();
+  }
+  for (std::string const &settingName : unwatched) {
+    json request;
+    request["REQUEST_NAME"] = "UNSUBSCRIBE_SETTING";
+    request["CONFIG_ID"] = configId;
+    request["SETTING_NAME"] = settingName;
+    sendJsonNoWait(request);
   }
   return SUCCESS;
 }
@@ -15,48 +15,97 @@
 # include <iostream>
 # include <optional>
 # include <map>
+# include <unordered_map>
+# include <unordered_set>
+# include <mutex>
 # include "LibError.hpp"
 # include "Albinos.h"
 # include "uvw.hpp"
 # include "json.hpp"
 # include "KeyWrapper.hpp"
 # include "Subscription.hpp"
+# include "Request.hpp"
+# include "Response.hpp"
+# include "SettingValue.hpp"
+# include "Connection.hpp"
 
 namespace Albinos
 {
   class Config
   {
 
-    static constexpr uvw::TimerHandle::Time writeTimeout{std::chrono::duration<uint64_t, std::milli>(200)};
+    friend class Connection;
 
     using json = nlohmann::json;
 
-    std::optional<ReturnedValue> irrecoverable;
+    std::shared_ptr<Connection> connection{Connection::get()};
+
+    // guards everything below that can be reached from several threads
+    mutable std::mutex mutex;
 
     std::optional<std::string> name;
     uint32_t configId;
-    std::vector<uint32_t> depsIds;
+    bool loaded{false};
 
-    std::string lastRequestedValue;
     std::map<std::string, Subscription*> settingsSubscriptions;
     std::vector<SettingUpdatedData> settingsUpdates;
-    bool waitingForResponse{false};
+    // readable while settingsUpdates isn't empty, created by getSubscriptionsFd()
+    int eventsFd{-1};
+    // without an I/O thread, also watches the loop so that unread events wake the user up
+    int subscriptionsPollFd{-1};
+
+    // asynchronous requests by REQUEST_ID, until their answer comes
+    mutable std::unordered_map<uint64_t, Request *> pendingRequests;
+    mutable std::vector<Request *> receivedRequests;
+
+    // values read from the service, erased when an event or a local write changes them
+    bool cacheEnabled{true};
+    mutable std::unordered_map<std::string, json> settingsCache;
+    // settings subscribed to only to keep the cache coherent, with the REQUEST_ID of their
+    // SUBSCRIBE_SETTING until the service accepts it, 0 after
+    mutable std::unordered_map<std::string, uint64_t> cacheSubscriptions;
+    // bumped on every invalidation, a value read before a change must not be cached
+    mutable uint64_t cacheGeneration{0};
+
+    // changes buffered between beginUpdate() and commitUpdate()
+    bool updating{false};
+    json updatedSettings{json::object()};
+    std::unordered_set<std::string> removedSettings;
 
     std::optional<KeyWrapper> key;
     std::optional<KeyWrapper> roKey;
-    std::unique_ptr<std::vector<std::string>> settingNames;
+    // filled by getLocalSettingsNames(), the names it returned point into it
+    mutable std::unique_ptr<std::vector<std::string>> settingNames;
 
-    std::shared_ptr<uvw::Loop> socketLoop{uvw::Loop::getDefault()};
-    std::shared_ptr<uvw::PipeHandle> socket{socketLoop->resource<uvw::PipeHandle>()};
-    std::shared_ptr<uvw::TimerHandle> timer{socketLoop->resource<uvw::TimerHandle>()};
+    json sendJson(json const &data) const;
+    void sendJsonAsync(json const &data, ResponseType type, Request *request) const;
+    void sendJsonNoWait(json const &data) const;
 
-    void initSocket();
-    void sendJson(json const &data) const;
+    void onAnswer(Request *request, ResponseType type, uint64_t requestId, json const &answer) const;
+    void parseEvent(json const &data);
+    void onEventsDropped();
 
-    void parseResponse(json const &data);
+    Request *newRequest(FCPTR_ON_REQUEST_COMPLETED onCompleted, void *data, Request **request) const;
+    void failPendingRequests(ReturnedValue error);
+    void deliverRequests();
 
     void loadConfig(KeyWrapper const &givenKey);
 
+    void signalEvents() const;
+    void clearEvents() const;
+
+    std::optional<json> fetchSettingValue(char const *settingName) const;
+    ReturnedValue fetchTypedValue(char const *settingName, json &value) const;
+    void watchForCache(char const *settingName) const;
+    void onCacheSubscription(std::string const &settingName, uint64_t requestId, json const &answer) const;
+    bool isWatched(std::string const &settingName) const;
+    void cancelCacheSubscriptions() const;
+    void invalidateCache(std::string const &settingName) const;
+
+    ReturnedValue setSettingValue(char const *name, json const &value);
+
+    static Setting *allocateSettings(std::vector<std::pair<std::string, std::optional<std::string>>> const &settings);
+
   public:
 
     Config(std::string const &name);
@@ -68,12 +117,27 @@ namespace Albinos
     ReturnedValue getReadOnlyKey(Key *configKey) const;
     ReturnedValue getSettingValue(char const *settingName, char *value, size_t valueSize) const;
     ReturnedValue getSettingSize(char const *settingName, size_t *size) const;
+    ReturnedValue getSettings(char const * const *names, size_t count, Setting **settings) const;
+    ReturnedValue getSettingType(char const *settingName, SettingType *type) const;
+    ReturnedValue getSettingInt(char const *settingName, int64_t *value) const;
+    ReturnedValue getSettingDouble(char const *settingName, double *value) const;
+    ReturnedValue getSettingBool(char const *settingName, bool *value) const;
+    ReturnedValue getSettingBlob(char const *settingName, void *data, size_t size) const;
 
     ReturnedValue setSetting(char const *name, char const *value);
+    ReturnedValue setSettingInt(char const *name, int64_t value);
+    ReturnedValue setSettingDouble(char const *name, double value);
+    ReturnedValue setSettingBool(char const *name, bool value);
+    ReturnedValue setSettingBlob(char const *name, void const *data, size_t size);
     ReturnedValue setSettingAlias(char const *name, char const *aliasName);
 
     ReturnedValue unsetAlias(char const *aliasName);
     ReturnedValue removeSetting(char const *name);
+    ReturnedValue removeSettings(char const * const *names, size_t count);
+
+    ReturnedValue beginUpdate();
+    ReturnedValue commitUpdate();
+    ReturnedValue cancelUpdate();
 
     ReturnedValue include(Key *inheritFrom, int position);
     ReturnedValue uninclude(Key *otherConfig, int position);
@@ -87,6 +151,14 @@ namespace Albinos
 
     ReturnedValue subscribeToSetting(char const *settingName, void *data, FCPTR_ON_CHANGE_NOTIFIER onChange, Subscription **subscription);
     ReturnedValue pollSubscriptions();
+    ReturnedValue getSubscriptionsFd(int *fd);
+
+    ReturnedValue getSettingValueAsync(char const *settingName, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, Request **request);
+    ReturnedValue setSettingAsync(char const *name, char const *value, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, Request **request);
+    ReturnedValue removeSettingAsync(char const *name, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, Request **request);
+    ReturnedValue pollRequests();
+
+    ReturnedValue setSettingsCacheEnabled(bool enabled);
 
   };
 }
@@ -0,0 +1,321 @@
+# include <cstdlib>
+# include <cstring>
+# include <filesystem>
+# include <future>
+# include <iostream>
+# include <uv.h>
+# include "Connection.hpp"
+# include "Config.hpp"
+# include "Tracer.hpp"
+
+std::atomic<bool> Albinos::Connection::ioThreadRequested{false};
+std::mutex Albinos::Connection::sharedMutex;
+std::weak_ptr<Albinos::Connection> Albinos::Connection::shared;
+
+std::shared_ptr<Albinos::Connection> Albinos::Connection::get()
+{
+  std::lock_guard<std::mutex> lock(sharedMutex);
+
+  // the connection lives as long as a Config uses it
+  std::shared_ptr<Connection> connection = shared.lock();
+  if (!connection) {
+    connection = std::make_shared<Connection>(ioThreadRequested.load());
+    shared = connection;
+  }
+  return connection;
+}
+
+std::shared_ptr<Albinos::Connection> Albinos::Connection::getIfOpen()
+{
+  std::lock_guard<std::mutex> lock(sharedMutex);
+  return shared.lock();
+}
+
+void Albinos::Connection::setIoThreadEnabled(bool enabled)
+{
+  ioThreadRequested = enabled;
+}
+
+void Albinos::Connection::AnswerSlot::set(json const &receivedAnswer)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    answer = receivedAnswer;
+    ready = true;
+  }
+  received.notify_one();
+}
+
+bool Albinos::Connection::AnswerSlot::isReady()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return ready;
+}
+
+bool Albinos::Connection::AnswerSlot::waitFor(std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  return received.wait_for(lock, timeout, [this]() { return ready; });
+}
+
+///
+/// \todo better error management
+///
+Albinos::Connection::Connection(bool threaded)
+  : threaded(threaded)
+  , loop(threaded ? uvw::Loop::create() : uvw::Loop::getDefault())
+{
+  char const *socketPathEnv = std::getenv("ALBINOS_SOCKET_PATH");
+  std::string socketPath = socketPathEnv && *socketPathEnv
+    ? socketPathEnv
+    : (std::filesystem::temp_directory_path() / "raven-os_service_albinos.sock").string();
+
+  socket->on<uvw::ErrorEvent>([this](const uvw::ErrorEvent&e, uvw::PipeHandle&) {
+    std::cout << "Error" << std::endl;
+    switch (e.code()) {
+      /// \todo catch relevant value from libuv http://docs.libuv.org/en/v1.x/errors.html
+    default:
+      irrecoverable = UNKNOWN;
+    }
+    failPendingAnswers();
+  });
+  socket->once<uvw::ConnectEvent>([](const uvw::ConnectEvent&, uvw::PipeHandle &sock) {
+    sock.read();
+  });
+  socket->on<uvw::DataEvent>([this](const uvw::DataEvent &dataEvent, uvw::PipeHandle &) {
+    Tracer::Span span("receive");
+    readBuffer.feed(dataEvent.data.get(), dataEvent.length);
+    // nothing may throw out of a libuv callback, a malformed message is skipped
+    while (auto message = readBuffer.next()) {
+      json data = json::parse(*message, nullptr, false);
+      if (data.is_object())
+        onMessage(data);
+    }
+  });
+  timer->on<uvw::TimerEvent>([this](const uvw::TimerEvent&, uvw::TimerHandle &handle) {
+    timedOut = true;
+    handle.stop();
+  });
+  socket->connect(socketPath);
+  if (!threaded) {
+    loop->run<uvw::Loop::Mode::ONCE>();
+    return;
+  }
+  wakeUp = loop->resource<uvw::AsyncHandle>();
+  wakeUp->on<uvw::AsyncEvent>([this](const uvw::AsyncEvent &, uvw::AsyncHandle &) {
+    runTasks();
+  });
+  ioThread = std::thread([this]() {
+    ioThreadId = std::this_thread::get_id();
+    loop->run();
+  });
+}
+
+Albinos::Connection::~Connection()
+{
+  if (!threaded) {
+    timer->close();
+    socket->close();
+    return;
+  }
+  // once every handle is closed, the loop has nothing left to do and the thread ends
+  execute([this]() {
+    timer->close();
+    socket->close();
+    wakeUp->close();
+  });
+  ioThread.join();
+  // tasks pushed after the last wake up are dropped
+  while (tasks.pop());
+}
+
+bool Albinos::Connection::isIoThread() const
+{
+  return threaded && std::this_thread::get_id() == ioThreadId.load();
+}
+
+void Albinos::Connection::runTasks()
+{
+  while (auto task = tasks.pop())
+    (*task)();
+}
+
+void Albinos::Connection::execute(Task task)
+{
+  if (!threaded || isIoThread()) {
+    task();
+    return;
+  }
+  tasks.push(std::move(task));
+  wakeUp->send();
+}
+
+void Albinos::Connection::executeAndWait(Task task)
+{
+  if (!threaded || isIoThread()) {
+    task();
+    return;
+  }
+  std::promise<void> done;
+  std::future<void> doneFuture = done.get_future();
+  execute([&task, &done]() {
+    task();
+    done.set_value();
+  });
+  doneFuture.wait();
+}
+
+void Albinos::Connection::onMessage(json const &data)
+{
+  // if the data received do not contain 'REQUEST_STATE', it's an event
+  if (data.find("REQUEST_STATE") == data.end()) {
+    // the service held back events the socket couldn't take, and had to drop some of them
+    if (data.find("EVENTS_DROPPED") != data.end()) {
+      for (auto &[configId, config] : configs)
+        config->onEventsDropped();
+      return;
+    }
+    auto configId = data.find("CONFIG_ID");
+    if (configId == data.end() || !configId->is_number_unsigned())
+      return;
+    auto config = configs.find(configId->get<uint32_t>());
+    if (config != configs.end())
+      config->second->parseEvent(data);
+    return;
+  }
+  auto requestId = data.find("REQUEST_ID");
+  if (requestId == data.end() || !requestId->is_number_unsigned())
+    return;
+  auto pending = pendingAnswers.find(requestId->get<uint64_t>());
+  if (pending == pendingAnswers.end())
+    return;
+  AnswerHandler handler = std::move(pending->second);
+  uint64_t id = pending->first;
+  pendingAnswers.erase(pending);
+  if (!Tracer::isEnabled()) {
+    handler(id, data);
+    return;
+  }
+  std::string traceId = Tracer::traceId(id);
+  Tracer::Span span("answer", traceId);
+  Tracer::recordFlow('f', traceId, Tracer::Clock::now());
+  handler(id, data);
+}
+
+void Albinos::Connection::failPendingAnswers()
+{
+  std::unordered_map<uint64_t, AnswerHandler> failed;
+
+  failed.swap(pendingAnswers);
+  for (auto &[id, handler] : failed)
+    handler(id, json());
+}
+
+void Albinos::Connection::write(uint64_t requestId, std::string &&serialized, AnswerHandler &&handler)
+{
+  if (irrecoverable != SUCCESS) {
+    handler(requestId, json());
+    return;
+  }
+  pendingAnswers.emplace(requestId, std::move(handler));
+
+  Tracer::Span span("write");
+  std::unique_ptr<char[]> buffer(new char[serialized.size()]);
+  std::memcpy(buffer.get(), serialized.data(), serialized.size());
+  socket->write(std::move(buffer), static_cast<unsigned int>(serialized.size()));
+}
+
+uint64_t Albinos::Connection::newRequestId()
+{
+  return ++lastRequestId;
+}
+
+void Albinos::Connection::send(uint64_t requestId, json &data, AnswerHandler handler)
+{
+  data["REQUEST_ID"] = requestId;
+  std::optional<Tracer::Span> span;
+  if (Tracer::isEnabled()) {
+    std::string traceId = Tracer::traceId(requestId);
+    data["TRACE_ID"] = traceId;
+    span.emplace("send", traceId);
+    Tracer::recordFlow('s', traceId, Tracer::Clock::now());
+  }
+  execute([this, requestId, serialized = data.dump(), handler = std::move(handler)]() mutable {
+    write(requestId, std::move(serialized), std::move(handler));
+  });
+}
+
+///
+/// Without an I/O thread, answers to other requests and events received meanwhile are dispatched as they come.
+/// With one, it must not be called from the I/O thread, which would wait for itself.
+///
+Albinos::Connection::json Albinos::Connection::request(json &data)
+{
+  auto slot = std::make_shared<AnswerSlot>();
+  uint64_t requestId = newRequestId();
+  Tracer::Span span("request", Tracer::isEnabled() ? Tracer::traceId(requestId) : "");
+  send(requestId, data, [slot](uint64_t, json const &answer) {
+    slot->set(answer);
+  });
+
+  bool answered;
+  if (threaded) {
+    answered = slot->waitFor(answerTimeout);
+  } else {
+    timedOut = false;
+    timer->start(answerTimeout, uvw::TimerHandle::Time{0});
+    while (!slot->isReady() && !timedOut && irrecoverable == SUCCESS)
+      loop->run<uvw::Loop::Mode::ONCE>();
+    timer->stop();
+    answered = slot->isReady();
+  }
+  if (!answered) {
+    execute([this, requestId]() {
+      cancel(requestId);
+    });
+    return json();
+  }
+  return slot->answer;
+}
+
+void Albinos::Connection::poll()
+{
+  if (!threaded && irrecoverable == SUCCESS)
+    loop->run<uvw::Loop::Mode::NOWAIT>();
+}
+
+void Albinos::Connection::cancel(uint64_t requestId)
+{
+  pendingAnswers.erase(requestId);
+}
+
+void Albinos::Connection::registerConfig(uint32_t configId, Config *config)
+{
+  configs[configId] = config;
+}
+
+void Albinos::Connection::unregisterConfig(uint32_t configId, Config *config)
+{
+  auto registered = configs.find(configId);
+  if (registered != configs.end() && registered->second == config)
+    configs.erase(registered);
+}
+
+std::optional<Albinos::ReturnedValue> Albinos::Connection::getError() const
+{
+  ReturnedValue error = irrecoverable;
+
+  if (error == SUCCESS)
+    return std::nullopt;
+  return error;
+}
+
+bool Albinos::Connection::hasIoThread() const
+{
+  return threaded;
+}
+
+int Albinos::Connection::getLoopFd() const
+{
+  return uv_backend_fd(loop->raw());
+}
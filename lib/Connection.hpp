@@ -0,0 +1,175 @@
+///
+/// \file Connection.hpp
+/// \author albinos-team
+/// \brief connection to the service, shared by every Config of the process
+///
+
+#pragma once
+
+# include <memory>
+# include <optional>
+# include <functional>
+# include <unordered_map>
+# include <atomic>
+# include <mutex>
+# include <condition_variable>
+# include <thread>
+# include "Albinos.h"
+# include "uvw.hpp"
+# include "json.hpp"
+# include "MessageBuffer.hpp"
+# include "MpscQueue.hpp"
+
+namespace Albinos
+{
+  class Config;
+
+  ///
+  /// \brief one socket to the service for the whole process
+  ///
+  /// Every request is tagged with a REQUEST_ID echoed back by the service, which is used
+  /// to hand the answer to the handler given at send time.
+  /// Subscription events are routed to the Config registered for their CONFIG_ID.
+  ///
+  /// By default the loop is run by the thread waiting for an answer or polling.
+  /// With an I/O thread, the connection has its own loop run by a background thread,
+  /// and other threads submit work to it through a lock-free queue.
+  ///
+  class Connection
+  {
+  public:
+
+    using json = nlohmann::json;
+
+    ///
+    /// \brief called with the answer of a request, or with a null json if the connection failed
+    ///
+    using AnswerHandler = std::function<void(uint64_t requestId, json const &answer)>;
+
+    using Task = std::function<void()>;
+
+  private:
+
+    static constexpr std::chrono::milliseconds answerTimeout{200};
+
+    ///
+    /// \brief where a synchronous request waits for its answer
+    ///
+    struct AnswerSlot
+    {
+      std::mutex mutex;
+      std::condition_variable received;
+      bool ready{false};
+      json answer;
+
+      void set(json const &receivedAnswer);
+      bool isReady();
+      bool waitFor(std::chrono::milliseconds timeout);
+    };
+
+    static std::atomic<bool> ioThreadRequested;
+    static std::mutex sharedMutex;
+    static std::weak_ptr<Connection> shared;
+
+    bool const threaded;
+    std::shared_ptr<uvw::Loop> loop;
+    std::shared_ptr<uvw::PipeHandle> socket{loop->resource<uvw::PipeHandle>()};
+    std::shared_ptr<uvw::TimerHandle> timer{loop->resource<uvw::TimerHandle>()};
+    MessageBuffer readBuffer;
+
+    std::atomic<ReturnedValue> irrecoverable{SUCCESS};
+    bool timedOut{false};
+
+    std::atomic<uint64_t> lastRequestId{0};
+
+    // only used by the thread running the loop
+    std::unordered_map<uint64_t, AnswerHandler> pendingAnswers;
+    std::unordered_map<uint32_t, Config *> configs;
+
+    // I/O thread mode
+    std::shared_ptr<uvw::AsyncHandle> wakeUp;
+    MpscQueue<Task> tasks;
+    std::thread ioThread;
+    std::atomic<std::thread::id> ioThreadId;
+
+    void onMessage(json const &data);
+    void failPendingAnswers();
+    void write(uint64_t requestId, std::string &&serialized, AnswerHandler &&handler);
+    void runTasks();
+    bool isIoThread() const;
+
+  public:
+
+    explicit Connection(bool threaded);
+    ~Connection();
+
+    Connection(Connection const &) = delete;
+    Connection &operator=(Connection const &) = delete;
+
+    ///
+    /// \brief the connection of the process, opened if no Config holds it yet
+    ///
+    static std::shared_ptr<Connection> get();
+
+    ///
+    /// \brief the connection of the process if a Config holds it, nullptr otherwise
+    ///
+    static std::shared_ptr<Connection> getIfOpen();
+
+    ///
+    /// \brief choose whether the next opened connection runs its own I/O thread
+    ///
+    static void setIoThreadEnabled(bool enabled);
+
+    ///
+    /// \brief run a task on the thread owning the loop. Inline without an I/O thread.
+    ///
+    void execute(Task task);
+
+    ///
+    /// \brief like execute(), and return once the task ran
+    ///
+    void executeAndWait(Task task);
+
+    uint64_t newRequestId();
+
+    ///
+    /// \brief tag data with requestId and write it, without waiting for the answer
+    ///
+    /// The handler is called by the thread owning the loop.
+    ///
+    void send(uint64_t requestId, json &data, AnswerHandler handler);
+
+    ///
+    /// \brief send data and wait for the answer, at most answerTimeout
+    /// \return the answer, a null json if it did not come
+    ///
+    json request(json &data);
+
+    ///
+    /// \brief handle everything already received, without blocking. Nothing to do with an I/O thread.
+    ///
+    void poll();
+
+    ///
+    /// \brief forget a request, its answer will be dropped. Must be run through execute().
+    ///
+    void cancel(uint64_t requestId);
+
+    ///
+    /// \brief route events of configId to config. Must be run through execute().
+    ///
+    void registerConfig(uint32_t configId, Config *config);
+    void unregisterConfig(uint32_t configId, Config *config);
+
+    std::optional<ReturnedValue> getError() const;
+
+    bool hasIoThread() const;
+
+    ///
+    /// \brief file descriptor readable when the loop has I/O to process, see uv_backend_fd()
+    ///
+    int getLoopFd() const;
+
+  };
+}
@@ -0,0 +1,52 @@
+# include "MessageBuffer.hpp"
+
+void Albinos::MessageBuffer::feed(char const *data, size_t size)
+{
+  buffer.append(data, size);
+}
+
+std::string Albinos::MessageBuffer::take(size_t end)
+{
+  std::string message = buffer.substr(start, end - start);
+  buffer.erase(0, end);
+  scanned = 0;
+  start = 0;
+  depth = 0;
+  inString = false;
+  escaped = false;
+  return message;
+}
+
+///
+/// messages aren't delimited on the socket, so we track the nesting depth outside of strings
+///
+std::optional<std::string> Albinos::MessageBuffer::next()
+{
+  while (scanned < buffer.size()) {
+    char c = buffer[scanned];
+    if (depth == 0) {
+      if (c != '{' && c != '[') {
+	// the service only sends objects, skip anything in between
+	++scanned;
+	continue;
+      }
+      start = scanned;
+    }
+    ++scanned;
+    if (inString) {
+      if (escaped)
+	escaped = false;
+      else if (c == '\\')
+	escaped = true;
+      else if (c == '"')
+	inString = false;
+    } else if (c == '"') {
+      inString = true;
+    } else if (c == '{' || c == '[') {
+      ++depth;
+    } else if ((c == '}' || c == ']') && --depth == 0) {
+      return take(scanned);
+    }
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,37 @@
+///
+/// \file MessageBuffer.hpp
+/// \author albinos-team
+/// \brief split the data received from the service into json messages
+///
+
+#pragma once
+
+# include <string>
+# include <optional>
+
+namespace Albinos
+{
+  class MessageBuffer
+  {
+  private:
+
+    std::string buffer;
+    size_t scanned{0};
+    size_t start{0};
+    size_t depth{0};
+    bool inString{false};
+    bool escaped{false};
+
+    std::string take(size_t end);
+
+  public:
+
+    void feed(char const *data, size_t size);
+
+    ///
+    /// \brief extract the next complete message, if any
+    ///
+    std::optional<std::string> next();
+
+  };
+}
@@ -0,0 +1,76 @@
+///
+/// \file MpscQueue.hpp
+/// \author albinos-team
+/// \brief lock-free queue with many producers and a single consumer
+///
+
+#pragma once
+
+# include <atomic>
+# include <optional>
+# include <utility>
+
+namespace Albinos
+{
+  ///
+  /// \brief intrusive MPSC queue: push() may be called from any thread, pop() from a single one
+  ///
+  /// The queue always keeps one node, the oldest one, whose value was already popped.
+  /// A producer swaps the newest node and then links the previous one to it, so pop() may
+  /// briefly miss a value being pushed. The producer must then wake the consumer up.
+  ///
+  template <typename T>
+  class MpscQueue
+  {
+  private:
+
+    struct Node
+    {
+      std::atomic<Node *> next{nullptr};
+      std::optional<T> value;
+    };
+
+    std::atomic<Node *> newest;
+    Node *oldest;
+
+  public:
+
+    MpscQueue()
+      : newest(new Node)
+      , oldest(newest.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~MpscQueue()
+    {
+      while (pop());
+      delete oldest;
+    }
+
+    MpscQueue(MpscQueue const &) = delete;
+    MpscQueue &operator=(MpscQueue const &) = delete;
+
+    void push(T value)
+    {
+      Node *node = new Node;
+
+      node->value.emplace(std::move(value));
+      Node *previous = newest.exchange(node, std::memory_order_acq_rel);
+      previous->next.store(node, std::memory_order_release);
+    }
+
+    std::optional<T> pop()
+    {
+      Node *next = oldest->next.load(std::memory_order_acquire);
+
+      if (!next)
+	return std::nullopt;
+      std::optional<T> value(std::move(next->value));
+      next->value.reset();
+      delete oldest;
+      oldest = next;
+      return value;
+    }
+
+  };
+}
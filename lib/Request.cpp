@@ -0,0 +1,60 @@
+# include "Request.hpp"
+
+Albinos::Request::Request(FCPTR_ON_REQUEST_COMPLETED callBack, void *associatedData)
+  : callBack(callBack)
+  , associatedData(associatedData)
+{}
+
+void Albinos::Request::complete(ReturnedValue answerResult, std::string answerValue)
+{
+  if (received)
+    return;
+  received = true;
+  result = answerResult;
+  value = std::move(answerValue);
+}
+
+bool Albinos::Request::deliver()
+{
+  delivered = true;
+  if (callBack)
+    callBack(this, result);
+  return released;
+}
+
+bool Albinos::Request::release()
+{
+  released = true;
+  return delivered;
+}
+
+bool Albinos::Request::isReceived() const
+{
+  return received;
+}
+
+Albinos::ReturnedValue Albinos::Request::getResult() const
+{
+  return delivered ? result : REQUEST_PENDING;
+}
+
+std::string const &Albinos::Request::getValue() const
+{
+  return value;
+}
+
+void *Albinos::Request::getAssociatedUserData() const
+{
+  return associatedData;
+}
+
+Albinos::ReturnedValue Albinos::Request::fromRequestState(std::string const &state)
+{
+  if (state == "SUCCESS")
+    return SUCCESS;
+  if (state == "UNKNOWN_SETTING")
+    return UNKNOWN_SETTING;
+  if (state == "LIMIT_EXCEEDED")
+    return LIMIT_EXCEEDED;
+  return REQUEST_FAILED;
+}
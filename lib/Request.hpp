@@ -0,0 +1,55 @@
+///
+/// \file Request.hpp
+/// \author albinos-team
+/// \brief handle on a request sent without waiting for its answer
+///
+
+#pragma once
+
+# include "Albinos.h"
+# include <string>
+
+namespace Albinos
+{
+  class Request
+  {
+  private:
+
+    FCPTR_ON_REQUEST_COMPLETED callBack;
+    void *associatedData;
+    ReturnedValue result{REQUEST_PENDING};
+    std::string value;
+    bool received{false};
+    bool delivered{false};
+    bool released{false};
+
+  public:
+
+    Request(FCPTR_ON_REQUEST_COMPLETED callBack, void *associatedData);
+
+    ///
+    /// \brief store the answer, it will be visible once deliver() is called
+    ///
+    void complete(ReturnedValue answerResult, std::string answerValue = "");
+
+    ///
+    /// \brief make the answer visible and call the callback
+    /// \return true if the request was released by the user and must be deleted
+    ///
+    bool deliver();
+
+    ///
+    /// \brief called by releaseRequest()
+    /// \return true if the request can be deleted now, otherwise it will be once delivered
+    ///
+    bool release();
+
+    bool isReceived() const;
+    ReturnedValue getResult() const;
+    std::string const &getValue() const;
+    void *getAssociatedUserData() const;
+
+    static ReturnedValue fromRequestState(std::string const &state);
+
+  };
+}
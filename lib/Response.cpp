@@ -0,0 +1,99 @@
+# include "Response.hpp"
+# include "Request.hpp"
+# include "SettingValue.hpp"
+
+Albinos::Response::Response(ResponseType type, json const &answer)
+  : answer(answer)
+  , result(decodeState())
+{
+  if (result == SUCCESS && !hasFields(type))
+    result = INVALID_REPONSE_FROM_SERVICE;
+}
+
+Albinos::ReturnedValue Albinos::Response::decodeState() const
+{
+  if (answer.is_null())
+    return CONNECTION_ERROR;
+  if (!answer.is_object())
+    return INVALID_REPONSE_FROM_SERVICE;
+  auto state = answer.find("REQUEST_STATE");
+  if (state == answer.end() || !state->is_string())
+    return INVALID_REPONSE_FROM_SERVICE;
+  return Request::fromRequestState(state->get_ref<std::string const &>());
+}
+
+bool Albinos::Response::hasFields(ResponseType type) const
+{
+  switch (type) {
+
+  case ResponseType::STATE:
+    return true;
+
+  case ResponseType::CONFIG_KEYS:
+    return has("CONFIG_KEY", &json::is_string) && has("READONLY_CONFIG_KEY", &json::is_string);
+
+  case ResponseType::CONFIG_INFO:
+    return has("CONFIG_NAME", &json::is_string) && has("CONFIG_ID", &json::is_number_unsigned);
+
+  case ResponseType::SETTING_VALUE:
+    return hasSettingValue();
+
+  case ResponseType::SETTINGS:
+    return hasSettings();
+
+  case ResponseType::SETTINGS_NAMES:
+    return hasArrayOf("SETTINGS_NAMES", &json::is_string);
+
+  case ResponseType::DEPS:
+    return hasArrayOf("DEPS", &json::is_number_unsigned);
+  }
+  return false;
+}
+
+bool Albinos::Response::has(char const *field, bool (json::*isExpectedType)() const noexcept) const
+{
+  auto found = answer.find(field);
+
+  return found != answer.end() && ((*found).*isExpectedType)();
+}
+
+bool Albinos::Response::hasArrayOf(char const *field, bool (json::*isExpectedType)() const noexcept) const
+{
+  auto found = answer.find(field);
+
+  if (found == answer.end() || !found->is_array())
+    return false;
+  for (json const &element : *found)
+    if (!(element.*isExpectedType)())
+      return false;
+  return true;
+}
+
+bool Albinos::Response::hasSettingValue() const
+{
+  auto value = answer.find("SETTING_VALUE");
+
+  return value != answer.end() && SettingValue::isValid(*value);
+}
+
+bool Albinos::Response::hasSettings() const
+{
+  auto settings = answer.find("SETTINGS");
+
+  if (settings == answer.end() || !settings->is_object())
+    return false;
+  for (json const &value : *settings)
+    if (!SettingValue::isValid(value))
+      return false;
+  return true;
+}
+
+Albinos::ReturnedValue Albinos::Response::getResult() const
+{
+  return result;
+}
+
+Albinos::Response::json const &Albinos::Response::operator[](char const *field) const
+{
+  return *answer.find(field);
+}
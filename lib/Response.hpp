@@ -0,0 +1,69 @@
+///
+/// \file Response.hpp
+/// \author albinos-team
+/// \brief answer of the service, decoded according to the request it answers
+///
+
+#pragma once
+
+# include "Albinos.h"
+# include "json.hpp"
+
+namespace Albinos
+{
+  ///
+  /// \brief what the answer of a request carries besides REQUEST_STATE
+  ///
+  enum class ResponseType
+    {
+     STATE,		///< nothing else
+     CONFIG_KEYS,	///< CONFIG_CREATE: CONFIG_KEY and READONLY_CONFIG_KEY
+     CONFIG_INFO,	///< CONFIG_LOAD: CONFIG_NAME and CONFIG_ID
+     SETTING_VALUE,	///< SETTING_GET
+     SETTINGS,		///< SETTINGS_GET and CONFIG_GET_SETTINGS
+     SETTINGS_NAMES,	///< CONFIG_GET_SETTINGS_NAMES
+     DEPS,		///< CONFIG_GET_DEPS
+    };
+
+  ///
+  /// \brief check an answer against the type expected by its request
+  ///
+  /// Fields are looked up with find() and their json type is checked, so a missing or
+  /// malformed answer makes the result INVALID_REPONSE_FROM_SERVICE instead of throwing.
+  /// Once the result is SUCCESS, every field of the type can be read without checks.
+  ///
+  class Response
+  {
+  public:
+
+    using json = nlohmann::json;
+
+  private:
+
+    json const &answer;
+    ReturnedValue result;
+
+    ReturnedValue decodeState() const;
+    bool hasFields(ResponseType type) const;
+    bool has(char const *field, bool (json::*isExpectedType)() const noexcept) const;
+    bool hasArrayOf(char const *field, bool (json::*isExpectedType)() const noexcept) const;
+    bool hasSettingValue() const;
+    bool hasSettings() const;
+
+  public:
+
+    ///
+    /// \param answer kept by reference, must outlive the response. A null json means no answer came.
+    ///
+    Response(ResponseType type, json const &answer);
+    Response(ResponseType type, json &&answer) = delete;
+
+    ReturnedValue getResult() const;
+
+    ///
+    /// \brief a field of the answer, which must be one of its type if the result is SUCCESS
+    ///
+    json const &operator[](char const *field) const;
+
+  };
+}
@@ -0,0 +1,114 @@
+# include <array>
+# include "SettingValue.hpp"
+
+namespace
+{
+  constexpr char blobKeyword[] = "BLOB";
+  constexpr char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  std::string encodeBase64(unsigned char const *data, size_t size)
+  {
+    std::string encoded;
+
+    encoded.reserve((size + 2) / 3 * 4);
+    for (size_t i = 0 ; i < size ; i += 3) {
+      uint32_t chunk = static_cast<uint32_t>(data[i]) << 16;
+      if (i + 1 < size)
+	chunk |= static_cast<uint32_t>(data[i + 1]) << 8;
+      if (i + 2 < size)
+	chunk |= data[i + 2];
+      encoded += base64Alphabet[(chunk >> 18) & 0x3F];
+      encoded += base64Alphabet[(chunk >> 12) & 0x3F];
+      encoded += i + 1 < size ? base64Alphabet[(chunk >> 6) & 0x3F] : '=';
+      encoded += i + 2 < size ? base64Alphabet[chunk & 0x3F] : '=';
+    }
+    return encoded;
+  }
+
+  std::optional<std::string> decodeBase64(std::string const &encoded)
+  {
+    static std::array<int8_t, 256> const values = []()
+      {
+	std::array<int8_t, 256> table;
+	table.fill(-1);
+	for (int8_t i = 0 ; i < 64 ; ++i)
+	  table[static_cast<unsigned char>(base64Alphabet[i])] = i;
+	return table;
+      }();
+    std::string decoded;
+
+    if (encoded.size() % 4)
+      return std::nullopt;
+    decoded.reserve(encoded.size() / 4 * 3);
+    for (size_t i = 0 ; i < encoded.size() ; i += 4) {
+      bool last = i + 4 == encoded.size();
+      size_t padding = 0;
+      uint32_t chunk = 0;
+      for (size_t j = 0 ; j < 4 ; ++j) {
+	char c = encoded[i + j];
+	if (c == '=' && last && j >= 2) {
+	  ++padding;
+	  chunk <<= 6;
+	  continue;
+	}
+	int8_t value = values[static_cast<unsigned char>(c)];
+	if (value < 0 || padding)
+	  return std::nullopt;
+	chunk = (chunk << 6) | static_cast<uint32_t>(value);
+      }
+      decoded += static_cast<char>((chunk >> 16) & 0xFF);
+      if (padding < 2)
+	decoded += static_cast<char>((chunk >> 8) & 0xFF);
+      if (padding < 1)
+	decoded += static_cast<char>(chunk & 0xFF);
+    }
+    return decoded;
+  }
+}
+
+bool Albinos::SettingValue::isValid(json const &value)
+{
+  return getType(value).has_value();
+}
+
+std::optional<Albinos::SettingType> Albinos::SettingValue::getType(json const &value)
+{
+  if (value.is_string())
+    return STRING_VALUE;
+  if (value.is_number_integer())
+    return INT_VALUE;
+  if (value.is_number_float())
+    return DOUBLE_VALUE;
+  if (value.is_boolean())
+    return BOOL_VALUE;
+  if (value.is_object() && value.size() == 1) {
+    auto blob = value.find(blobKeyword);
+    if (blob != value.end() && blob->is_string())
+      return BLOB_VALUE;
+  }
+  return std::nullopt;
+}
+
+Albinos::SettingValue::json Albinos::SettingValue::fromBlob(void const *data, size_t size)
+{
+  json value;
+
+  value[blobKeyword] = encodeBase64(static_cast<unsigned char const *>(data), size);
+  return value;
+}
+
+std::optional<std::string> Albinos::SettingValue::toBlob(json const &value)
+{
+  if (getType(value) != BLOB_VALUE)
+    return std::nullopt;
+  return decodeBase64(value.find(blobKeyword)->get_ref<std::string const &>());
+}
+
+std::string Albinos::SettingValue::toString(json const &value)
+{
+  if (value.is_string())
+    return value.get<std::string>();
+  if (auto blob = toBlob(value))
+    return std::move(*blob);
+  return value.dump();
+}
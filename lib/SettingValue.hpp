@@ -0,0 +1,43 @@
+///
+/// \file SettingValue.hpp
+/// \author albinos-team
+/// \brief setting values as carried by the protocol
+///
+
+#pragma once
+
+# include <optional>
+# include <string>
+# include "Albinos.h"
+# include "json.hpp"
+
+namespace Albinos
+{
+  ///
+  /// \brief a setting value is a json string, number or boolean, or a blob: {"BLOB": "<base64 data>"}
+  ///
+  /// The service stores values with their json type, so typed settings are never converted to text.
+  ///
+  class SettingValue
+  {
+  public:
+
+    using json = nlohmann::json;
+
+    static bool isValid(json const &value);
+    static std::optional<SettingType> getType(json const &value);
+
+    static json fromBlob(void const *data, size_t size);
+
+    ///
+    /// \return the decoded bytes, nullopt if the value isn't a valid blob
+    ///
+    static std::optional<std::string> toBlob(json const &value);
+
+    ///
+    /// \brief the value as given to getSettingValue(): strings as is, the bytes of blobs, the json text of the others
+    ///
+    static std::string toString(json const &value);
+
+  };
+}
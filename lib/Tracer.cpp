@@ -0,0 +1,96 @@
+# include <atomic>
+# include <mutex>
+# include <vector>
+# include <unistd.h>
+# include <sys/syscall.h>
+# include "Tracer.hpp"
+
+namespace
+{
+  std::atomic<bool> enabled{false};
+  std::mutex eventsMutex;
+  std::vector<nlohmann::json> events;
+
+  // the events of a long trace are dropped rather than growing without bound
+  constexpr size_t maxEvents = 1u << 20;
+
+  int64_t toMicroseconds(Albinos::Tracer::Clock::time_point time)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+  }
+
+  void push(nlohmann::json &&event)
+  {
+    static thread_local long tid = syscall(SYS_gettid);
+
+    event["pid"] = static_cast<int>(getpid());
+    event["tid"] = tid;
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    if (events.size() < maxEvents)
+      events.push_back(std::move(event));
+  }
+}
+
+Albinos::Tracer::Span::Span(char const *name, std::string traceId)
+  : name(name)
+  , traceId(std::move(traceId))
+{
+  if (isEnabled())
+    start = Clock::now();
+}
+
+Albinos::Tracer::Span::~Span()
+{
+  if (start == Clock::time_point{})
+    return;
+  try {
+    recordSpan(name, start, Clock::now(), traceId);
+  } catch (std::exception const &) {
+  }
+}
+
+bool Albinos::Tracer::isEnabled()
+{
+  return enabled.load(std::memory_order_relaxed);
+}
+
+void Albinos::Tracer::setEnabled(bool enable)
+{
+  enabled = enable;
+}
+
+std::string Albinos::Tracer::traceId(uint64_t requestId)
+{
+  return std::to_string(getpid()) + "-" + std::to_string(requestId);
+}
+
+void Albinos::Tracer::recordSpan(char const *name, Clock::time_point start, Clock::time_point end, std::string const &traceId)
+{
+  json event{{"name", name}, {"cat", "albinos"}, {"ph", "X"},
+	     {"ts", toMicroseconds(start)}, {"dur", toMicroseconds(end) - toMicroseconds(start)}};
+
+  if (!traceId.empty())
+    event["args"] = {{"TRACE_ID", traceId}};
+  push(std::move(event));
+}
+
+void Albinos::Tracer::recordFlow(char phase, std::string const &traceId, Clock::time_point time)
+{
+  json event{{"name", "request"}, {"cat", "flow"}, {"ph", std::string(1, phase)},
+	     {"ts", toMicroseconds(time)}, {"id", traceId}};
+
+  // the end of the flow binds to the span it is in, not to the next one
+  if (phase == 'f')
+    event["bp"] = "e";
+  push(std::move(event));
+}
+
+Albinos::Tracer::json Albinos::Tracer::takeEvents()
+{
+  std::vector<json> taken;
+  {
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    taken.swap(events);
+  }
+  return json(std::move(taken));
+}
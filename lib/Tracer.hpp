@@ -0,0 +1,70 @@
+///
+/// \file Tracer.hpp
+/// \author albinos-team
+/// \brief spans of the requests, exported as Chrome trace events
+///
+
+#pragma once
+
+# include <chrono>
+# include <cstdint>
+# include <string>
+# include "json.hpp"
+
+namespace Albinos
+{
+  ///
+  /// \brief records where the time of the requests goes in the library, while tracing is enabled
+  ///
+  /// Timestamps are steady_clock microseconds, the system-wide monotonic clock on linux,
+  /// so these spans line up with the ones recorded by the service.
+  /// Each request gets a TRACE_ID, from the process id and its REQUEST_ID, which links its spans
+  /// in both processes with flow events.
+  ///
+  class Tracer
+  {
+  public:
+
+    using json = nlohmann::json;
+    using Clock = std::chrono::steady_clock;
+
+    ///
+    /// \brief records its scope as a span, if tracing was enabled when it started
+    ///
+    class Span
+    {
+    private:
+
+      char const *name;
+      std::string traceId;
+      Clock::time_point start;
+
+    public:
+
+      explicit Span(char const *name, std::string traceId = "");
+      ~Span();
+
+      Span(Span const &) = delete;
+      Span &operator=(Span const &) = delete;
+
+    };
+
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    static std::string traceId(uint64_t requestId);
+
+    static void recordSpan(char const *name, Clock::time_point start, Clock::time_point end, std::string const &traceId);
+
+    ///
+    /// \param phase 's' when the request leaves, 'f' when its answer is handled
+    ///
+    static void recordFlow(char phase, std::string const &traceId, Clock::time_point time);
+
+    ///
+    /// \brief the Chrome trace events recorded since the last call
+    ///
+    static json takeEvents();
+
+  };
+}
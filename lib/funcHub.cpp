@@ -1,11 +1,79 @@
+#include <fstream>
 #include "funcHub.hpp"
 #include "Subscription.hpp"
+#include "Request.hpp"
 
 void Albinos::unsubscribe(Subscription *sub)
 {
   delete sub;
 }
 
+void Albinos::setIoThreadEnabled(int enabled)
+{
+  Connection::setIoThreadEnabled(enabled != 0);
+}
+
+Albinos::ReturnedValue Albinos::setTracingEnabled(int enabled)
+{
+  Tracer::setEnabled(enabled != 0);
+  // without a Config the process isn't connected, and opening a connection only to trace isn't worth it
+  std::shared_ptr<Connection> connection = Connection::getIfOpen();
+  if (!connection)
+    return SUCCESS;
+  nlohmann::json request = {{"REQUEST_NAME", "SERVICE_TRACE"}, {"ENABLE", enabled != 0}};
+  nlohmann::json answer = connection->request(request);
+  return connection->getError().value_or(Response(ResponseType::STATE, answer).getResult());
+}
+
+Albinos::ReturnedValue Albinos::writeTrace(char const *path)
+{
+  if (!path)
+    return BAD_PARAMETERS;
+  ReturnedValue result = SUCCESS;
+  nlohmann::json answer;
+  if (std::shared_ptr<Connection> connection = Connection::getIfOpen()) {
+    nlohmann::json request = {{"REQUEST_NAME", "SERVICE_TRACE"}};
+    answer = connection->request(request);
+    result = connection->getError().value_or(Response(ResponseType::STATE, answer).getResult());
+  }
+  nlohmann::json traceEvents = Tracer::takeEvents();
+  if (result == SUCCESS) {
+    auto serviceEvents = answer.find("TRACE_EVENTS");
+    if (serviceEvents != answer.end() && serviceEvents->is_array())
+      traceEvents.insert(traceEvents.end(), serviceEvents->begin(), serviceEvents->end());
+  }
+  std::ofstream file(path);
+  file << nlohmann::json{{"traceEvents", std::move(traceEvents)}}.dump();
+  if (!file)
+    return UNKNOWN;
+  return result;
+}
+
+void Albinos::releaseRequest(Request *request)
+{
+  if (request && request->release())
+    delete request;
+}
+
+Albinos::ReturnedValue Albinos::getRequestResult(Request const *request)
+{
+  if (!request)
+    return BAD_PARAMETERS;
+  return request->getResult();
+}
+
+char const *Albinos::getRequestValue(Request const *request)
+{
+  if (!request || request->getResult() == REQUEST_PENDING)
+    return nullptr;
+  return request->getValue().c_str();
+}
+
+void *Albinos::getRequestUserData(Request const *request)
+{
+  return request->getAssociatedUserData();
+}
+
 Albinos::ReturnedValue Albinos::createConfig(char const *configName, Config **returnedConfig)
 {
   try {
@@ -76,6 +144,50 @@ Albinos::ReturnedValue Albinos::setSetting(Config *config, char const *name, cha
   }
 }
 
+Albinos::ReturnedValue Albinos::setSettingInt(Config *config, char const *name, int64_t value)
+{
+  if (!config || !name)
+    return BAD_PARAMETERS;
+  try {
+    return config->setSettingInt(name, value);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::setSettingDouble(Config *config, char const *name, double value)
+{
+  if (!config || !name)
+    return BAD_PARAMETERS;
+  try {
+    return config->setSettingDouble(name, value);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::setSettingBool(Config *config, char const *name, int value)
+{
+  if (!config || !name)
+    return BAD_PARAMETERS;
+  try {
+    return config->setSettingBool(name, value != 0);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::setSettingBlob(Config *config, char const *name, void const *data, size_t size)
+{
+  if (!config || !name || (!data && size))
+    return BAD_PARAMETERS;
+  try {
+    return config->setSettingBlob(name, data, size);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
 Albinos::ReturnedValue Albinos::setSettingAlias(Config *config, char const *name, char const *aliasName)
 {
   if (!config || !name || !aliasName)
@@ -109,6 +221,53 @@ Albinos::ReturnedValue Albinos::removeSetting(Config *config, char const *name)
   }
 }
 
+Albinos::ReturnedValue Albinos::removeSettings(Config *config, char const * const *names, size_t count)
+{
+  if (!config || !names)
+    return BAD_PARAMETERS;
+  for (size_t i = 0 ; i < count ; ++i)
+    if (!names[i])
+      return BAD_PARAMETERS;
+  try {
+    return config->removeSettings(names, count);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::beginUpdate(Config *config)
+{
+  if (!config)
+    return BAD_PARAMETERS;
+  try {
+    return config->beginUpdate();
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::commitUpdate(Config *config)
+{
+  if (!config)
+    return BAD_PARAMETERS;
+  try {
+    return config->commitUpdate();
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::cancelUpdate(Config *config)
+{
+  if (!config)
+    return BAD_PARAMETERS;
+  try {
+    return config->cancelUpdate();
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
 Albinos::ReturnedValue Albinos::getSettingValue(Config const *config, char const *settingName, char *value, size_t valueSize)
 {
   if (!config || !settingName || !value)
@@ -120,6 +279,65 @@ Albinos::ReturnedValue Albinos::getSettingValue(Config const *config, char const
   }
 }
 
+Albinos::ReturnedValue Albinos::getSettingType(Config const *config, char const *settingName, SettingType *type)
+{
+  if (!config || !settingName || !type)
+    return BAD_PARAMETERS;
+  try {
+    return config->getSettingType(settingName, type);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::getSettingInt(Config const *config, char const *settingName, int64_t *value)
+{
+  if (!config || !settingName || !value)
+    return BAD_PARAMETERS;
+  try {
+    return config->getSettingInt(settingName, value);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::getSettingDouble(Config const *config, char const *settingName, double *value)
+{
+  if (!config || !settingName || !value)
+    return BAD_PARAMETERS;
+  try {
+    return config->getSettingDouble(settingName, value);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::getSettingBool(Config const *config, char const *settingName, int *value)
+{
+  if (!config || !settingName || !value)
+    return BAD_PARAMETERS;
+  try {
+    bool settingValue;
+    ReturnedValue result = config->getSettingBool(settingName, &settingValue);
+    if (result == SUCCESS)
+      *value = settingValue;
+    return result;
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::getSettingBlob(Config const *config, char const *settingName, void *data, size_t size)
+{
+  if (!config || !settingName || (!data && size))
+    return BAD_PARAMETERS;
+  try {
+    return config->getSettingBlob(settingName, data, size);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
 Albinos::ReturnedValue Albinos::getSettingSize(Config const *config, char const *settingName, size_t *size)
 {
   if (!config || !settingName || !size)
@@ -131,6 +349,31 @@ Albinos::ReturnedValue Albinos::getSettingSize(Config const *config, char const
   }
 }
 
+Albinos::ReturnedValue Albinos::setSettingsCacheEnabled(Config *config, int enabled)
+{
+  if (!config)
+    return BAD_PARAMETERS;
+  try {
+    return config->setSettingsCacheEnabled(enabled != 0);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::getSettings(Config const *config, char const * const *names, size_t count, Setting **settings)
+{
+  if (!config || (!names && count) || !settings)
+    return BAD_PARAMETERS;
+  for (size_t i = 0 ; i < count ; ++i)
+    if (!names[i])
+      return BAD_PARAMETERS;
+  try {
+    return config->getSettings(names, count, settings);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
 Albinos::ReturnedValue Albinos::include(Config *config, Key *inheritFrom, int position)
 {
   if (!config || !inheritFrom)
@@ -215,13 +458,11 @@ void Albinos::destroySettingsNamesArray(char const * const *names)
 
 void Albinos::destroySettingsArray(Setting *settings, size_t size)
 {
+  (void)size;
   if (!settings)
     return;
-  for (size_t i = 0 ; i < size ; ++i) {
-    delete settings[i].name;
-    delete settings[i].value;
-  }
-  delete[] settings;
+  // the settings and their strings are a single block, see Config::allocateSettings()
+  delete[] reinterpret_cast<char *>(settings);
 }
 
 Albinos::ReturnedValue Albinos::getLocalAliases(Config const *config, Alias **aliases, size_t *size)
@@ -268,6 +509,61 @@ Albinos::ReturnedValue Albinos::pollSubscriptions(Config *config)
   }
 }
 
+Albinos::ReturnedValue Albinos::getSubscriptionsFd(Config *config, int *fd)
+{
+  if (!config || !fd)
+    return BAD_PARAMETERS;
+  try {
+    return config->getSubscriptionsFd(fd);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::getSettingValueAsync(Config *config, char const *settingName, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, Request **request)
+{
+  if (!config || !settingName)
+    return BAD_PARAMETERS;
+  try {
+    return config->getSettingValueAsync(settingName, data, onCompleted, request);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::setSettingAsync(Config *config, char const *name, char const *value, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, Request **request)
+{
+  if (!config || !name || !value)
+    return BAD_PARAMETERS;
+  try {
+    return config->setSettingAsync(name, value, data, onCompleted, request);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::removeSettingAsync(Config *config, char const *name, void *data, FCPTR_ON_REQUEST_COMPLETED onCompleted, Request **request)
+{
+  if (!config || !name)
+    return BAD_PARAMETERS;
+  try {
+    return config->removeSettingAsync(name, data, onCompleted, request);
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
+Albinos::ReturnedValue Albinos::pollRequests(Config *config)
+{
+  if (!config)
+    return BAD_PARAMETERS;
+  try {
+    return config->pollRequests();
+  } catch (LibError const &e) {
+    return e.getCode();
+  }
+}
+
 void *Albinos::getSubscriptionUserData(struct Albinos::Subscription const *subscription)
 {
   return subscription->getAssociatedUserData();
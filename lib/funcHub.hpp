@@ -14,3 +14,5 @@
 # include "Albinos.h"
 # include "Config.hpp"
 # include "Subscription.hpp"
+# include "Request.hpp"
+# include "Tracer.hpp"
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace raven
+{
+  class buffer_pool
+  {
+  public:
+    /*
+     * Output buffers, recycled by size class once libuv is done writing them
+     *
+     * Classes are powers of two from min_size to max_size, a buffer going back to the class its capacity fills.
+     * acquire() takes the smallest free buffer big enough for the hint, so a buffer which grew while an answer
+     * was serialized into it serves the next big answers. Bigger buffers, or buffers past max_free_per_class,
+     * are freed.
+     *
+     */
+
+    static constexpr std::size_t min_size = 256;
+    static constexpr std::size_t max_size = 64 * 1024;
+    static constexpr std::size_t max_free_per_class = 64;
+
+    std::string acquire(std::size_t size_hint = min_size)
+    {
+        for (auto index = class_index(size_hint); index < nb_classes; ++index) {
+            if (!free_[index].empty()) {
+                std::string buffer = std::move(free_[index].back());
+                free_[index].pop_back();
+                ++nb_reused_;
+                return buffer;
+            }
+        }
+        ++nb_allocated_;
+        std::string buffer;
+        buffer.reserve(std::max(size_hint, min_size));
+        return buffer;
+    }
+
+    void release(std::string &&buffer) noexcept
+    {
+        if (buffer.capacity() < min_size || buffer.capacity() > max_size)
+            return;
+        auto index = class_index(buffer.capacity() + 1) - 1;
+        if (free_[index].size() == max_free_per_class)
+            return;
+        buffer.clear();
+        free_[index].push_back(std::move(buffer));
+    }
+
+    //! Buffers which had to be allocated, and buffers taken from the pool
+    std::uint64_t nb_allocated() const noexcept
+    {
+        return nb_allocated_;
+    }
+
+    std::uint64_t nb_reused() const noexcept
+    {
+        return nb_reused_;
+    }
+
+  private:
+    static constexpr std::size_t nb_classes = 9;
+
+    //! First class whose buffers hold size bytes
+    static std::size_t class_index(std::size_t size) noexcept
+    {
+        std::size_t index = 0;
+        for (auto class_size = min_size; class_size < size && index < nb_classes; class_size *= 2)
+            ++index;
+        return index;
+    }
+
+    std::array<std::vector<std::string>, nb_classes> free_;
+    std::uint64_t nb_allocated_{0};
+    std::uint64_t nb_reused_{0};
+  };
+}
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+TEST_CASE ("buffer pool")
+{
+    raven::buffer_pool pool;
+    SUBCASE("released buffers are reused") {
+        auto buffer = pool.acquire();
+        buffer += R"({"REQUEST_STATE":"SUCCESS"})";
+        pool.release(std::move(buffer));
+        auto reused = pool.acquire();
+        CHECK(reused.empty());
+        CHECK_GE(reused.capacity(), raven::buffer_pool::min_size);
+        CHECK_EQ(pool.nb_allocated(), 1u);
+        CHECK_EQ(pool.nb_reused(), 1u);
+    }
+    SUBCASE("a small buffer doesn't serve a big hint") {
+        pool.release(pool.acquire());
+        auto big = pool.acquire(4096);
+        CHECK_GE(big.capacity(), 4096u);
+        CHECK_EQ(pool.nb_allocated(), 2u);
+        pool.release(std::move(big));
+        pool.acquire(100);
+        CHECK_EQ(pool.nb_reused(), 1u);
+    }
+    SUBCASE("huge buffers are not kept") {
+        std::string huge;
+        huge.reserve(raven::buffer_pool::max_size * 2);
+        pool.release(std::move(huge));
+        pool.acquire();
+        CHECK_EQ(pool.nb_reused(), 0u);
+    }
+}
+#endif
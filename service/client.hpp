@@ -4,17 +4,62 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "service_strong_types.hpp"
+#include "message_buffer.hpp"
 
 namespace raven
 {
+  //! What the clients of a listener may do
+  enum class access_policy
+  {
+    read_write,
+    read_only //! requests modifying a config are refused
+  };
+
+  //! Per-client limits, 0 meaning unlimited
+  struct client_limits
+  {
+    std::size_t max_loaded_configs{1024};
+    std::size_t max_subscriptions{65536};
+    //! Sustained rate, a client may send up to a second worth of requests at once
+    std::uint32_t max_requests_per_second{0};
+    //! A client sending a longer message is disconnected, as its read buffer would have to hold all of it
+    std::size_t max_message_size{16u << 20};
+    //! Bytes left to write to the client past which its events are held back
+    std::size_t output_high_water_mark{1u << 20};
+    //! Events held back for a client, once coalesced, past which the oldest ones are dropped
+    std::size_t max_held_events{4096};
+    //! A client staying past the high-water mark that long is disconnected
+    std::chrono::milliseconds stall_timeout{30000};
+  };
+
+  //! What a client consumed since it connected
+  struct client_usage
+  {
+    std::uint64_t nb_requests{0};
+    //! Requests refused with LIMIT_EXCEEDED
+    std::uint64_t nb_rejected{0};
+    std::uint64_t bytes_in{0};
+    std::uint64_t bytes_out{0};
+    //! Events merged with a later event on the same setting, or dropped, while held back
+    std::uint64_t events_coalesced{0};
+    std::uint64_t events_dropped{0};
+  };
+
   class client
   {
   private:
     using client_ptr = std::shared_ptr<uvw::PipeHandle>;
   public:
-    explicit client(client_ptr sock) noexcept : sock_(std::move(sock))
+    explicit client(client_ptr sock, access_policy access = access_policy::read_write) noexcept
+    : sock_(std::move(sock)), access_(access)
     {
     }
 
@@ -24,18 +69,93 @@ namespace raven
     {
         last_id++;
         config_ids_.insert({{last_id.value(), db_id.value()}});
-        reverse_config_ids_.insert({{db_id.value(), last_id.value()}});
+        //! a config loaded twice gets two ids, each with its own subscriptions
+        reverse_config_ids_[db_id.value()].push_back(last_id.value());
         return last_id;
     }
 
-    void remove_temp_id(raven::config_id_st id)
+    //! Returns the settings the config was subscribed to under this id
+    std::unordered_set<raven::setting_id_st::value_type> remove_temp_id(raven::config_id_st id)
     {
         DLOG_F(INFO, "erasing id: %lu from config: %d", id.value(), static_cast<int>(this->sock_->fileno()));
-        if (config_ids_.find(id.value()) != config_ids_.end()) {
-            auto db_id = config_ids_.at(id.value());
-            reverse_config_ids_.erase(db_id);
+        std::unordered_set<raven::setting_id_st::value_type> settings;
+        auto it = config_ids_.find(id.value());
+        if (it == config_ids_.end())
+            return settings;
+        auto reverse_it = reverse_config_ids_.find(it->second);
+        auto &ids = reverse_it->second;
+        ids.erase(std::find(ids.begin(), ids.end(), id.value()));
+        if (ids.empty())
+            reverse_config_ids_.erase(reverse_it);
+        if (auto sub_it = sub_settings_.find(id.value()); sub_it != sub_settings_.end()) {
+            settings.swap(sub_it->second);
+            sub_settings_.erase(sub_it);
+        }
+        config_ids_.erase(it);
+        return settings;
+    }
+
+    std::size_t nb_loaded_configs() const noexcept
+    {
+        return config_ids_.size();
+    }
+
+    client_usage &get_usage() noexcept
+    {
+        return usage_;
+    }
+
+    const client_usage &get_usage() const noexcept
+    {
+        return usage_;
+    }
+
+    //! Token bucket refilled at max_requests_per_second, false if the request must be refused
+    bool take_request_token(const client_limits &limits, std::chrono::steady_clock::time_point now) noexcept
+    {
+        if (!limits.max_requests_per_second)
+            return true;
+        double burst = limits.max_requests_per_second;
+        if (last_refill_ == std::chrono::steady_clock::time_point{})
+            request_tokens_ = burst;
+        else {
+            std::chrono::duration<double> elapsed = now - last_refill_;
+            request_tokens_ = std::min(burst, request_tokens_ + elapsed.count() * burst);
         }
-        config_ids_.erase(id.value());
+        last_refill_ = now;
+        if (request_tokens_ < 1.0)
+            return false;
+        request_tokens_ -= 1.0;
+        return true;
+    }
+
+    /*
+     * Whether the client is past the high-water mark, so that its events must be held back
+     *
+     * The first time it goes past the mark is kept, to find the clients which stay stuck
+     *
+     */
+    bool is_backlogged(const client_limits &limits, std::chrono::steady_clock::time_point now)
+    {
+        if (!limits.output_high_water_mark || sock_->writeQueueSize() <= limits.output_high_water_mark) {
+            backlogged_since_.reset();
+            return false;
+        }
+        if (!backlogged_since_)
+            backlogged_since_ = now;
+        return true;
+    }
+
+    bool is_stalled(const client_limits &limits, std::chrono::steady_clock::time_point now) const noexcept
+    {
+        return limits.stall_timeout.count() && backlogged_since_
+               && now - backlogged_since_.value() >= limits.stall_timeout;
+    }
+
+    //! Events dropped since the client was last told about it
+    std::uint64_t &unreported_drops() noexcept
+    {
+        return unreported_drops_;
     }
 
     config_id_st get_last_id() const noexcept
@@ -43,35 +163,59 @@ namespace raven
         return last_id;
     }
 
-    void subscribe(raven::config_id_st id, const std::string &setting_name)
+    void subscribe(raven::config_id_st id, raven::setting_id_st setting_id)
     {
-        // TODO check if not subscribed
-        sub_settings_.insert({config_ids_.at(id.value()), setting_name});
+        sub_settings_[id.value()].insert(setting_id.value());
     }
 
-    void unsubscribe(raven::config_id_st id, const std::string &setting_name)
+    //! False if the config was not subscribed to the setting
+    bool unsubscribe(raven::config_id_st id, raven::setting_id_st setting_id)
     {
-        DLOG_F(INFO, "unsubscribing setting: %s within config id: %lu from client: %d", setting_name.c_str(), id.value(),
+        DLOG_F(INFO, "unsubscribing setting id: %u within config id: %lu from client: %d", setting_id.value(), id.value(),
                static_cast<int>(this->sock_->fileno()));
-        auto range = sub_settings_.equal_range(config_ids_.at(id.value()));
-        for (auto it = range.first; it != range.second; ++it) {
-            if (it->second == setting_name) {
-                sub_settings_.erase(it);
-                break;
-            }
+        auto it = sub_settings_.find(id.value());
+        if (it == sub_settings_.end() || !it->second.erase(setting_id.value()))
+            return false;
+        if (it->second.empty())
+            sub_settings_.erase(it);
+        return true;
+    }
+
+    bool is_subscribed(raven::config_id_st id, raven::setting_id_st setting_id) const
+    {
+        auto it = sub_settings_.find(id.value());
+        return it != sub_settings_.end() && it->second.count(setting_id.value()) > 0;
+    }
+
+    //! Calls func with each id under which the client loaded db_id and subscribed to setting_id
+    template <typename Func>
+    void for_each_subscribed_id(raven::config_id_st db_id, raven::setting_id_st setting_id, Func &&func) const
+    {
+        auto it = reverse_config_ids_.find(db_id.value());
+        if (it == reverse_config_ids_.end())
+            return;
+        for (auto id : it->second) {
+            if (is_subscribed(raven::config_id_st{id}, setting_id))
+                func(raven::config_id_st{id});
         }
     }
 
-    bool is_subscribed(raven::config_id_st db_id, const std::string &setting_name)
+    //! Calls func with the setting of each subscription of the client
+    template <typename Func>
+    void for_each_subscription(Func &&func) const
     {
-        if (sub_settings_.find(db_id.value()) == sub_settings_.end())
-            return false;
-        auto range = sub_settings_.equal_range(db_id.value());
-        for (auto it = range.first; it != range.second; ++it) {
-            if (it->second == setting_name)
-                return true;
+        for (auto &[id, settings] : sub_settings_) {
+            for (auto setting_id : settings)
+                func(raven::setting_id_st{setting_id});
         }
-        return false;
+    }
+
+    std::size_t nb_subscriptions() const noexcept
+    {
+        std::size_t nb = 0;
+        for (auto &[db_id, settings] : sub_settings_)
+            nb += settings.size();
+        return nb;
     }
 
     client_ptr &get_socket()
@@ -79,14 +223,19 @@ namespace raven
         return sock_;
     }
 
-    raven::config_id_st get_db_id_from(raven::config_id_st id)
+    message_buffer &get_read_buffer() noexcept
     {
-        return raven::config_id_st{config_ids_.at(id.value())};
+        return read_buffer_;
     }
 
-    raven::config_id_st get_id_from_db(raven::config_id_st db_id)
+    access_policy get_access() const noexcept
+    {
+        return access_;
+    }
+
+    raven::config_id_st get_db_id_from(raven::config_id_st id)
     {
-        return raven::config_id_st{reverse_config_ids_.at(db_id.value())};
+        return raven::config_id_st{config_ids_.at(id.value())};
     }
 
     bool has_loaded(raven::config_id_st id)
@@ -101,9 +250,97 @@ namespace raven
 
   private:
     client_ptr sock_;
+    access_policy access_;
+    message_buffer read_buffer_;
+    client_usage usage_;
+    double request_tokens_{0};
+    std::chrono::steady_clock::time_point last_refill_{};
+    std::optional<std::chrono::steady_clock::time_point> backlogged_since_{std::nullopt};
+    std::uint64_t unreported_drops_{0};
     raven::config_id_st last_id{0};
     std::unordered_map<raven::config_id_st::value_type, raven::config_id_st::value_type> config_ids_;
-    std::unordered_map<raven::config_id_st::value_type, raven::config_id_st::value_type> reverse_config_ids_; // temporary workaround for a basic id lookup, will need in the future to be able to do that outside of the client class
-    std::unordered_multimap<raven::config_id_st::value_type, std::string> sub_settings_;
+    std::unordered_map<raven::config_id_st::value_type, std::vector<raven::config_id_st::value_type>> reverse_config_ids_; // temporary workaround for a basic id lookup, will need in the future to be able to do that outside of the client class
+    std::unordered_map<raven::config_id_st::value_type, std::unordered_set<raven::setting_id_st::value_type>> sub_settings_; // settings subscribed to, by temporary id
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+    TEST_CASE_CLASS ("client subscriptions")
+    {
+        client client_{uvw::Loop::getDefault()->resource<uvw::PipeHandle>()};
+        auto id = client_.insert_db_id(config_id_st{42});
+        SUBCASE("subscribe is deduplicated") {
+            client_.subscribe(id, setting_id_st{1});
+            client_.subscribe(id, setting_id_st{1});
+            CHECK(client_.is_subscribed(id, setting_id_st{1}));
+            CHECK_FALSE(client_.is_subscribed(id, setting_id_st{2}));
+            CHECK_EQ(client_.nb_subscriptions(), 1u);
+            CHECK(client_.unsubscribe(id, setting_id_st{1}));
+            CHECK_FALSE(client_.is_subscribed(id, setting_id_st{1}));
+            CHECK_FALSE(client_.unsubscribe(id, setting_id_st{1}));
+        }
+        SUBCASE("unload drops every subscription of the config") {
+            for (std::uint32_t i = 0; i < 100; ++i)
+                client_.subscribe(id, setting_id_st{i});
+            CHECK_EQ(client_.nb_subscriptions(), 100u);
+            CHECK_EQ(client_.remove_temp_id(id).size(), 100u);
+            CHECK_EQ(client_.nb_subscriptions(), 0u);
+            CHECK_FALSE(client_.is_subscribed(id, setting_id_st{1}));
+        }
+        SUBCASE("a config loaded twice keeps apart the subscriptions of each load") {
+            auto other_id = client_.insert_db_id(config_id_st{42});
+            client_.subscribe(id, setting_id_st{1});
+            client_.subscribe(other_id, setting_id_st{1});
+            std::vector<config_id_st> ids;
+            client_.for_each_subscribed_id(config_id_st{42}, setting_id_st{1}, [&ids](config_id_st loaded_id) {
+                ids.push_back(loaded_id);
+            });
+            CHECK_EQ(ids.size(), 2u);
+            client_.remove_temp_id(id);
+            ids.clear();
+            client_.for_each_subscribed_id(config_id_st{42}, setting_id_st{1}, [&ids](config_id_st loaded_id) {
+                ids.push_back(loaded_id);
+            });
+            REQUIRE_EQ(ids.size(), 1u);
+            CHECK_EQ(ids[0].value(), other_id.value());
+            CHECK(client_.has_loaded_db_id(config_id_st{42}));
+        }
+    }
+
+    TEST_CASE_CLASS ("client request rate")
+    {
+        client client_{uvw::Loop::getDefault()->resource<uvw::PipeHandle>()};
+        client_limits limits;
+        auto now = std::chrono::steady_clock::now();
+        SUBCASE("unlimited by default") {
+            for (int i = 0; i < 1000; ++i)
+                CHECK(client_.take_request_token(limits, now));
+        }
+        SUBCASE("a second worth of requests, then the sustained rate") {
+            limits.max_requests_per_second = 10;
+            for (int i = 0; i < 10; ++i)
+                CHECK(client_.take_request_token(limits, now));
+            CHECK_FALSE(client_.take_request_token(limits, now));
+            CHECK(client_.take_request_token(limits, now + std::chrono::milliseconds(100)));
+            CHECK_FALSE(client_.take_request_token(limits, now + std::chrono::milliseconds(100)));
+        }
+    }
+
+    TEST_CASE_CLASS ("client output limits")
+    {
+        client client_{uvw::Loop::getDefault()->resource<uvw::PipeHandle>()};
+        client_limits limits;
+        auto now = std::chrono::steady_clock::now();
+        client_.backlogged_since_ = now;
+        SUBCASE("a client backlogged too long is stalled") {
+            CHECK_FALSE(client_.is_stalled(limits, now));
+            CHECK(client_.is_stalled(limits, now + limits.stall_timeout));
+        }
+        SUBCASE("zeroed limits are unlimited") {
+            limits.output_high_water_mark = 0;
+            limits.stall_timeout = std::chrono::milliseconds(0);
+            CHECK_FALSE(client_.is_stalled(limits, now));
+            CHECK_FALSE(client_.is_backlogged(limits, now));
+        }
+    }
+#endif
   };
 };
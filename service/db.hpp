@@ -11,6 +11,9 @@
 #include <loguru.hpp>
 #include "service_strong_types.hpp"
 #include "utils.hpp"
+#include "stats.hpp"
+#include "log.hpp"
+#include "trace.hpp"
 
 namespace raven
 {
@@ -81,7 +84,7 @@ namespace raven
 
     explicit config_db(const std::filesystem::path &path_to_db) noexcept : database_{path_to_db.string()}
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         try {
             execute_statement(create_table_statement);
             execute_statement(create_unique_index_config_id_statement);
@@ -104,7 +107,9 @@ namespace raven
          *
          */
 
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
+        scoped_duration timer{busy_time_};
+        trace_span span{"config_db::config_create", "db"};
         using namespace std::string_literals;
         config_key_st config_key;
         config_key_st readonly_config_key;
@@ -161,7 +166,9 @@ namespace raven
          *
          */
 
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
+        scoped_duration timer{busy_time_};
+        trace_span span{"config_db::get_config_name", "db"};
         std::string config_name;
         auto functor_receive_data = [&config_name](const std::string json_text) {
             auto json_data = json::json::parse(json_text);
@@ -204,7 +211,9 @@ namespace raven
          *
          */
 
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
+        scoped_duration timer{busy_time_};
+        trace_span span{"config_db::get_config_id", "db"};
         config_id_st config_id;
         auto functor_receive_data = [&config_id](int id) { config_id = config_id_st{static_cast<std::size_t>(id)}; };
         try {
@@ -246,7 +255,9 @@ namespace raven
          *
          */
 
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
+        scoped_duration timer{busy_time_};
+        trace_span span{"config_db::get_config", "db"};
         json::json data;
         auto functor_receive_data = [&data](const std::string &json_text) { data = json::json::parse(json_text); };
         try {
@@ -279,7 +290,9 @@ namespace raven
          *
          */
 
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
+        scoped_duration timer{busy_time_};
+        trace_span span{"config_db::update_config", "db"};
         try {
             throw_misuse_if_count_return_zero_for_this_statement(select_count_config_from_id_statement, id.value());
             execute_statement(update_config_text_from_id_statement, updated_data.dump(), id.value());
@@ -315,6 +328,11 @@ namespace raven
      *  Return the state after the last operation
      */
 
+    std::chrono::nanoseconds busy_time() const noexcept { return busy_time_; }
+     /*
+     *  Return the time spent in queries since the database was opened
+     */
+
   private:
     template <typename ... Args>
     void throw_misuse_if_count_return_zero_for_this_statement(const db_statement_st &statement, Args &&...args)
@@ -329,6 +347,7 @@ namespace raven
     sqlite::database database_;
     static constexpr const unsigned int maximum_retries_{4};
     db_state state{db_state::ok};
+    std::chrono::nanoseconds busy_time_{0};
 
 #ifdef DOCTEST_LIBRARY_INCLUDED
     TEST_CASE_CLASS ("config_create db")
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "service.hpp"
+
+namespace raven
+{
+  /*
+   * Runs a service inside the calling process, on its own loop, socket path and thread
+   *
+   * Every instance is isolated, so tests and benchmarks can run several of them at once,
+   * and clients connected through connect_pair() measure the service without the socket path
+   *
+   */
+  class embedded_service
+  {
+  public:
+    explicit embedded_service(std::filesystem::path db_path,
+                              std::filesystem::path socket_path = unique_socket_path())
+    : socket_path_{socket_path}, service_{std::move(db_path), std::move(socket_path), loop_}
+    {
+        wake_up_->on<uvw::AsyncEvent>([this](const uvw::AsyncEvent &, uvw::AsyncHandle &) {
+            this->run_tasks();
+        });
+        listening_ = service_.listen();
+        thread_ = std::thread([this]() {
+            // the test build stops the loop when a client leaves, so run it until every handle is closed
+            while (loop_->alive())
+                loop_->run();
+        });
+    }
+
+    ~embedded_service() noexcept
+    {
+        // once every handle is closed, the loop has nothing left to do and the thread ends
+        execute([this]() {
+            service_.shutdown();
+            wake_up_->close();
+        });
+        thread_.join();
+    }
+
+    embedded_service(const embedded_service &) = delete;
+    embedded_service &operator=(const embedded_service &) = delete;
+
+    bool listening() const noexcept
+    {
+        return listening_;
+    }
+
+    const std::filesystem::path &socket_path() const noexcept
+    {
+        return socket_path_;
+    }
+
+    //! Connect a client through a socketpair, return the client end or -1 on error
+    int connect_pair(access_policy access = access_policy::read_write)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1)
+            return -1;
+        execute([this, fd = fds[1], access]() {
+            service_.add_client(fd, access);
+        });
+        return fds[0];
+    }
+
+    //! Applies to the clients connected afterwards too
+    void set_client_limits(const client_limits &limits)
+    {
+        execute([this, limits]() {
+            service_.set_client_limits(limits);
+        });
+    }
+
+  private:
+    static std::filesystem::path unique_socket_path()
+    {
+        static std::atomic<unsigned int> nb_instances{0};
+        return std::filesystem::temp_directory_path() /
+               ("albinos_embedded_" + std::to_string(getpid()) + "_" + std::to_string(nb_instances++) + ".sock");
+    }
+
+    //! Run a task on the loop thread, the service isn't thread-safe
+    void execute(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        wake_up_->send();
+    }
+
+    void run_tasks()
+    {
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex_);
+            tasks.swap(tasks_);
+        }
+        for (auto &task : tasks)
+            task();
+    }
+
+    std::shared_ptr<uvw::Loop> loop_{uvw::Loop::create()};
+    std::shared_ptr<uvw::AsyncHandle> wake_up_{loop_->resource<uvw::AsyncHandle>()};
+    std::filesystem::path socket_path_;
+    service service_;
+    std::mutex tasks_mutex_;
+    std::vector<std::function<void()>> tasks_;
+    bool listening_{false};
+    std::thread thread_;
+  };
+}
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+namespace
+{
+  nlohmann::json embedded_request(int fd, const std::string &request)
+  {
+      CHECK_EQ(write(fd, request.data(), request.size()), static_cast<ssize_t>(request.size()));
+      raven::message_buffer buffer;
+      char data[4096];
+      while (true) {
+          auto nb_read = read(fd, data, sizeof(data));
+          if (nb_read <= 0)
+              return nullptr;
+          buffer.feed(data, static_cast<std::size_t>(nb_read));
+          if (auto message = buffer.next())
+              return nlohmann::json::parse(message.value());
+      }
+  }
+
+  //! The events received before the answer to request
+  std::vector<nlohmann::json> embedded_events_before(int fd, const std::string &request)
+  {
+      CHECK_EQ(write(fd, request.data(), request.size()), static_cast<ssize_t>(request.size()));
+      std::vector<nlohmann::json> events;
+      raven::message_buffer buffer;
+      char data[4096];
+      while (true) {
+          auto nb_read = read(fd, data, sizeof(data));
+          if (nb_read <= 0)
+              return events;
+          buffer.feed(data, static_cast<std::size_t>(nb_read));
+          while (auto message = buffer.next()) {
+              auto json_data = nlohmann::json::parse(message.value());
+              if (json_data.contains("REQUEST_STATE"))
+                  return events;
+              events.push_back(std::move(json_data));
+          }
+      }
+  }
+}
+
+TEST_CASE ("embedded service")
+{
+    const auto request = std::string(R"({"REQUEST_NAME": "CONFIG_CREATE", "CONFIG_NAME": "embedded"})");
+    SUBCASE("client connected through a socketpair") {
+        auto db_path = std::filesystem::current_path() / "albinos_embedded_test_pair.db";
+        {
+            raven::embedded_service service{db_path};
+            int fd = service.connect_pair();
+            REQUIRE_NE(fd, -1);
+            CHECK_EQ(embedded_request(fd, request).at("REQUEST_STATE"), "SUCCESS");
+            close(fd);
+        }
+        std::filesystem::remove(db_path);
+    }
+    SUBCASE("service stats count the handled requests") {
+        auto db_path = std::filesystem::current_path() / "albinos_embedded_test_stats.db";
+        {
+            raven::embedded_service service{db_path};
+            int fd = service.connect_pair();
+            REQUIRE_NE(fd, -1);
+            embedded_request(fd, request);
+            embedded_request(fd, R"({"REQUEST_NAME": "CONFIG_UNLOAD", "CONFIG_ID": "not an id"})");
+            auto answer = embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_STATS"})");
+            CHECK_EQ(answer.at("REQUEST_STATE"), "SUCCESS");
+            auto &commands = answer.at("STATS").at("COMMANDS");
+            CHECK_EQ(commands.at("CONFIG_CREATE").at("COUNT"), 1);
+            CHECK_EQ(commands.at("CONFIG_CREATE").at("ANSWERS").at("SUCCESS"), 1);
+            CHECK_EQ(commands.at("CONFIG_CREATE").at("LATENCY_NS").at("TOTAL").at("COUNT"), 1);
+            CHECK_EQ(commands.at("CONFIG_UNLOAD").at("ERRORS"), 1);
+            CHECK_GE(answer.at("STATS").at("LOOP").at("ITERATIONS"), 1);
+            CHECK_GE(answer.at("STATS").at("BUFFERS").at("REUSED"), 1);
+            CHECK(answer.at("STATS").at("LOG").contains("DROPPED"));
+            close(fd);
+        }
+        std::filesystem::remove(db_path);
+    }
+    SUBCASE("requests over the threshold are kept as slow requests") {
+        auto db_path = std::filesystem::current_path() / "albinos_embedded_test_slow.db";
+        {
+            raven::embedded_service service{db_path};
+            int fd = service.connect_pair();
+            REQUIRE_NE(fd, -1);
+            embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_SLOW_REQUESTS", "THRESHOLD_US": 0})");
+            embedded_request(fd, request);
+            auto answer = embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_SLOW_REQUESTS", "THRESHOLD_US": null})");
+            CHECK_EQ(answer.at("REQUEST_STATE"), "SUCCESS");
+            auto &slow_requests = answer.at("SLOW_REQUESTS");
+            REQUIRE_EQ(slow_requests.size(), 2u);
+            CHECK_EQ(slow_requests[1].at("COMMAND"), "CONFIG_CREATE");
+            CHECK_EQ(slow_requests[1].at("PAYLOAD_SIZE"), request.size());
+            CHECK(slow_requests[1].at("LATENCY_US").contains("FAN_OUT"));
+            embedded_request(fd, request);
+            answer = embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_SLOW_REQUESTS"})");
+            CHECK_EQ(answer.at("SLOW_REQUESTS").size(), 2u);
+            close(fd);
+        }
+        std::filesystem::remove(db_path);
+    }
+    SUBCASE("clients over their limits are refused") {
+        auto db_path = std::filesystem::current_path() / "albinos_embedded_test_limits.db";
+        {
+            raven::embedded_service service{db_path};
+            raven::client_limits limits;
+            limits.max_loaded_configs = 1;
+            service.set_client_limits(limits);
+            int fd = service.connect_pair();
+            REQUIRE_NE(fd, -1);
+            auto key = embedded_request(fd, request).at("CONFIG_KEY").get<std::string>();
+            nlohmann::json load_request{{"REQUEST_NAME", "CONFIG_LOAD"}, {"CONFIG_KEY", key}};
+            CHECK_EQ(embedded_request(fd, load_request.dump()).at("REQUEST_STATE"), "SUCCESS");
+            CHECK_EQ(embedded_request(fd, load_request.dump()).at("REQUEST_STATE"), "LIMIT_EXCEEDED");
+            auto answer = embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_CLIENTS", "SORT_BY": "REJECTED"})");
+            REQUIRE_EQ(answer.at("CLIENTS").size(), 1u);
+            auto &usage = answer.at("CLIENTS")[0];
+            CHECK_EQ(usage.at("REQUESTS"), 4);
+            CHECK_EQ(usage.at("REJECTED"), 1);
+            CHECK_EQ(usage.at("CONFIGS"), 1);
+            CHECK_GT(usage.at("BYTES_IN"), 0);
+            CHECK_EQ(embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_CLIENTS", "SORT_BY": "NAME"})").at("REQUEST_STATE"),
+                     "BAD_ORDER");
+            close(fd);
+        }
+        std::filesystem::remove(db_path);
+    }
+    SUBCASE("clients sending a message over the maximum size are disconnected") {
+        auto db_path = std::filesystem::current_path() / "albinos_embedded_test_message_size.db";
+        {
+            raven::embedded_service service{db_path};
+            raven::client_limits limits;
+            limits.max_message_size = 64;
+            service.set_client_limits(limits);
+            int fd = service.connect_pair();
+            REQUIRE_NE(fd, -1);
+            CHECK_EQ(embedded_request(fd, request).at("REQUEST_STATE"), "SUCCESS");
+            CHECK_EQ(embedded_request(fd, R"({"REQUEST_NAME": "CONFIG_CREATE", "CONFIG_NAME": ")" + std::string(64, 'a')),
+                     nullptr);
+            close(fd);
+        }
+        std::filesystem::remove(db_path);
+    }
+    SUBCASE("a config loaded twice by a client gets the events of each load") {
+        auto db_path = std::filesystem::current_path() / "albinos_embedded_test_loaded_twice.db";
+        {
+            raven::embedded_service service{db_path};
+            int fd = service.connect_pair();
+            REQUIRE_NE(fd, -1);
+            auto key = embedded_request(fd, request).at("CONFIG_KEY").get<std::string>();
+            nlohmann::json load_request{{"REQUEST_NAME", "CONFIG_LOAD"}, {"CONFIG_KEY", key}};
+            auto first_id = embedded_request(fd, load_request.dump()).at("CONFIG_ID").get<std::size_t>();
+            auto second_id = embedded_request(fd, load_request.dump()).at("CONFIG_ID").get<std::size_t>();
+            REQUIRE_NE(first_id, second_id);
+            for (auto id : {first_id, second_id}) {
+                nlohmann::json subscribe_request{{"REQUEST_NAME", "SUBSCRIBE_SETTING"}, {"CONFIG_ID", id},
+                                                 {"SETTING_NAME", "shared"}};
+                CHECK_EQ(embedded_request(fd, subscribe_request.dump()).at("REQUEST_STATE"), "SUCCESS");
+            }
+            nlohmann::json update_request{{"REQUEST_NAME", "SETTING_UPDATE"}, {"CONFIG_ID", first_id},
+                                          {"SETTINGS_TO_UPDATE", {{"shared", "value"}}}};
+            const auto ping = std::string(R"({"REQUEST_NAME": "SERVICE_CLIENTS"})");
+            CHECK_EQ(embedded_request(fd, update_request.dump()).at("REQUEST_STATE"), "SUCCESS");
+            auto events = embedded_events_before(fd, ping);
+            REQUIRE_EQ(events.size(), 2u);
+            CHECK_NE(events[0].at("CONFIG_ID"), events[1].at("CONFIG_ID"));
+            nlohmann::json unload_request{{"REQUEST_NAME", "CONFIG_UNLOAD"}, {"CONFIG_ID", first_id}};
+            CHECK_EQ(embedded_request(fd, unload_request.dump()).at("REQUEST_STATE"), "SUCCESS");
+            update_request["CONFIG_ID"] = second_id;
+            CHECK_EQ(embedded_request(fd, update_request.dump()).at("REQUEST_STATE"), "SUCCESS");
+            events = embedded_events_before(fd, ping);
+            REQUIRE_EQ(events.size(), 1u);
+            CHECK_EQ(events[0].at("CONFIG_ID"), second_id);
+            close(fd);
+        }
+        std::filesystem::remove(db_path);
+    }
+    SUBCASE("traced requests are linked to their trace id") {
+        auto db_path = std::filesystem::current_path() / "albinos_embedded_test_trace.db";
+        {
+            raven::embedded_service service{db_path};
+            int fd = service.connect_pair();
+            REQUIRE_NE(fd, -1);
+            embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_TRACE", "ENABLE": true})");
+            embedded_request(fd, R"({"REQUEST_NAME": "CONFIG_CREATE", "CONFIG_NAME": "traced", "TRACE_ID": "42-1"})");
+            auto answer = embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_TRACE", "ENABLE": false})");
+            bool has_flow_step = false;
+            bool has_request_span = false;
+            bool has_db_span = false;
+            for (auto &event : answer.at("TRACE_EVENTS")) {
+                has_flow_step |= event.at("ph") == "t" && event.at("id") == "42-1";
+                has_request_span |= event.at("name") == "CONFIG_CREATE" && event.at("args").at("TRACE_ID") == "42-1";
+                has_db_span |= event.at("name") == "config_db::config_create";
+            }
+            CHECK(has_flow_step);
+            CHECK(has_request_span);
+            CHECK(has_db_span);
+            close(fd);
+        }
+        std::filesystem::remove(db_path);
+    }
+    SUBCASE("read-only client can't modify the configs") {
+        auto db_path = std::filesystem::current_path() / "albinos_embedded_test_read_only.db";
+        {
+            raven::embedded_service service{db_path};
+            int fd = service.connect_pair(raven::access_policy::read_only);
+            REQUIRE_NE(fd, -1);
+            CHECK_EQ(embedded_request(fd, request).at("REQUEST_STATE"), "UNAUTHORIZED");
+            auto load_request = std::string(R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY": "unknown"})");
+            CHECK_NE(embedded_request(fd, load_request).at("REQUEST_STATE"), "UNAUTHORIZED");
+            auto slow_requests = embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_SLOW_REQUESTS"})");
+            CHECK_EQ(slow_requests.at("REQUEST_STATE"), "SUCCESS");
+            slow_requests = embedded_request(fd, R"({"REQUEST_NAME": "SERVICE_SLOW_REQUESTS", "THRESHOLD_US": 0})");
+            CHECK_EQ(slow_requests.at("REQUEST_STATE"), "UNAUTHORIZED");
+            close(fd);
+        }
+        std::filesystem::remove(db_path);
+    }
+    SUBCASE("instances run side by side on their own socket") {
+        auto first_db_path = std::filesystem::current_path() / "albinos_embedded_test_first.db";
+        auto second_db_path = std::filesystem::current_path() / "albinos_embedded_test_second.db";
+        std::vector<std::filesystem::path> socket_paths;
+        {
+            raven::embedded_service first{first_db_path};
+            raven::embedded_service second{second_db_path};
+            REQUIRE(first.listening());
+            REQUIRE(second.listening());
+            CHECK_NE(first.socket_path(), second.socket_path());
+            for (auto *service : {&first, &second}) {
+                socket_paths.push_back(service->socket_path());
+                int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                sockaddr_un address{};
+                address.sun_family = AF_UNIX;
+                std::strncpy(address.sun_path, service->socket_path().c_str(), sizeof(address.sun_path) - 1);
+                REQUIRE_EQ(connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)), 0);
+                CHECK_EQ(embedded_request(fd, request).at("REQUEST_STATE"), "SUCCESS");
+                close(fd);
+            }
+        }
+        for (auto &socket_path : socket_paths)
+            CHECK_FALSE(std::filesystem::exists(socket_path));
+        std::filesystem::remove(first_db_path);
+        std::filesystem::remove(second_db_path);
+    }
+}
+#endif
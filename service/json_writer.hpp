@@ -0,0 +1,158 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <json.hpp>
+
+namespace raven
+{
+  //! Like dump(), but appends to a buffer which may come from a buffer_pool
+  inline void dump_to(std::string &buffer, const nlohmann::json &json_data)
+  {
+      nlohmann::detail::serializer<nlohmann::json> serializer{
+          nlohmann::detail::output_adapter<char, std::string>(buffer), ' '};
+      serializer.dump(json_data, false, false, 0);
+  }
+
+  class json_writer
+  {
+  public:
+    /*
+     * Writes a flat json object straight into a buffer, without building a json::json first
+     *
+     * The output is the same as dump() without indentation: strings are escaped the same way,
+     * but bytes past 0x7f are copied as they are instead of being checked as UTF-8.
+     * Keys are protocol keywords, so they are not escaped.
+     *
+     */
+
+    explicit json_writer(std::string &buffer) noexcept : buffer_{buffer}
+    {
+    }
+
+    json_writer &begin_object()
+    {
+        buffer_ += '{';
+        first_ = true;
+        return *this;
+    }
+
+    void end_object()
+    {
+        buffer_ += '}';
+    }
+
+    json_writer &key(std::string_view name)
+    {
+        if (!first_)
+            buffer_ += ',';
+        first_ = false;
+        buffer_ += '"';
+        buffer_ += name;
+        buffer_ += "\":";
+        return *this;
+    }
+
+    json_writer &value(std::string_view text)
+    {
+        static constexpr char hex_digits[] = "0123456789abcdef";
+        buffer_ += '"';
+        for (char c : text) {
+            switch (c) {
+                case '"':
+                    buffer_ += "\\\"";
+                    break;
+                case '\\':
+                    buffer_ += "\\\\";
+                    break;
+                case '\b':
+                    buffer_ += "\\b";
+                    break;
+                case '\f':
+                    buffer_ += "\\f";
+                    break;
+                case '\n':
+                    buffer_ += "\\n";
+                    break;
+                case '\r':
+                    buffer_ += "\\r";
+                    break;
+                case '\t':
+                    buffer_ += "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        buffer_ += "\\u00";
+                        buffer_ += hex_digits[static_cast<unsigned char>(c) >> 4];
+                        buffer_ += hex_digits[static_cast<unsigned char>(c) & 0xf];
+                    } else
+                        buffer_ += c;
+            }
+        }
+        buffer_ += '"';
+        return *this;
+    }
+
+    json_writer &value(const char *text)
+    {
+        return value(std::string_view(text));
+    }
+
+    json_writer &value(const std::string &text)
+    {
+        return value(std::string_view(text));
+    }
+
+    json_writer &value(std::uint64_t number)
+    {
+        char digits[24];
+        buffer_.append(digits, std::to_chars(digits, digits + sizeof(digits), number).ptr);
+        return *this;
+    }
+
+    json_writer &value(const nlohmann::json &json_data)
+    {
+        dump_to(buffer_, json_data);
+        return *this;
+    }
+
+    //! Already serialized json
+    json_writer &raw(std::string_view serialized)
+    {
+        buffer_ += serialized;
+        return *this;
+    }
+
+  private:
+    std::string &buffer_;
+    bool first_{true};
+  };
+}
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+TEST_CASE ("json writer")
+{
+    std::string buffer;
+    raven::json_writer writer{buffer};
+    SUBCASE("same output as dump") {
+        std::string text = "quote \" backslash \\ control \x01\n\t unicode \xc3\xa9";
+        nlohmann::json value{{"BLOB", "AAEC"}};
+        writer.begin_object()
+            .key("TEXT").value(text)
+            .key("NUMBER").value(std::uint64_t{42})
+            .key("VALUE").value(value)
+            .end_object();
+        nlohmann::json expected{{"TEXT", text}, {"NUMBER", 42}, {"VALUE", value}};
+        CHECK_EQ(nlohmann::json::parse(buffer), expected);
+        buffer.clear();
+        writer.begin_object().key("TEXT").value(text).end_object();
+        CHECK_EQ(buffer, (nlohmann::json{{"TEXT", text}}.dump()));
+    }
+    SUBCASE("empty object") {
+        writer.begin_object().end_object();
+        CHECK_EQ(buffer, "{}");
+    }
+}
+#endif
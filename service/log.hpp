@@ -0,0 +1,391 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <json.hpp>
+#include <loguru.hpp>
+
+namespace raven
+{
+  enum class log_level : int
+  {
+    debug,
+    info,
+    warning,
+    error,
+    off
+  };
+
+  inline const std::array<std::string_view, 5> log_level_names{"DEBUG", "INFO", "WARNING", "ERROR", "OFF"};
+
+  inline std::optional<log_level> log_level_from_name(std::string_view name) noexcept
+  {
+      for (std::size_t level = 0; level < log_level_names.size(); ++level)
+          if (log_level_names[level] == name)
+              return static_cast<log_level>(level);
+      return std::nullopt;
+  }
+
+  //! A log argument, turned into text only by the thread writing the line
+  using log_arg = std::variant<std::monostate, std::int64_t, std::uint64_t, double, bool, std::string, nlohmann::json>;
+
+  struct log_record
+  {
+    static constexpr std::size_t max_args = 4;
+
+    log_level level{log_level::info};
+    std::chrono::system_clock::time_point time;
+    const char *site{nullptr};
+    const char *format{nullptr};
+    std::array<log_arg, max_args> args;
+  };
+
+  class logger
+  {
+  public:
+    /*
+     * Logs of the request path
+     *
+     * The level is checked before the arguments are evaluated, so a disabled level costs one relaxed load.
+     * By default a line is formatted right away and handed to loguru.
+     * Once start_async() is called, records are pushed to a bounded lock-free ring buffer instead,
+     * and a background thread formats and writes them: the caller only copies the arguments.
+     * If the ring buffer is full, a warning or an error is written by the caller instead,
+     * and a record of a lower level is dropped and counted.
+     *
+     * The format uses {} for each argument, and json arguments are only dumped by the writing thread.
+     *
+     */
+
+    static logger &instance() noexcept
+    {
+        static logger instance;
+        return instance;
+    }
+
+    ~logger() noexcept
+    {
+        stop_async();
+    }
+
+    logger(const logger &) = delete;
+    logger &operator=(const logger &) = delete;
+
+    bool enabled(log_level level) const noexcept
+    {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    log_level get_level() const noexcept
+    {
+        return level_.load(std::memory_order_relaxed);
+    }
+
+    void set_level(log_level level) noexcept
+    {
+        level_.store(level, std::memory_order_relaxed);
+        //! loguru drops the synchronous debug lines unless its stderr verbosity lets them through
+        if (level == log_level::debug && loguru::g_stderr_verbosity < debug_verbosity)
+            loguru::g_stderr_verbosity = debug_verbosity;
+    }
+
+    void start_async(std::FILE *output = stderr)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        if (writer_.joinable())
+            return;
+        output_ = output;
+        stopping_ = false;
+        writer_ = std::thread([this]() { this->write_records(); });
+        async_.store(true, std::memory_order_release);
+    }
+
+    //! Write the records left and go back to synchronous logging
+    void stop_async() noexcept
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        if (!writer_.joinable())
+            return;
+        async_.store(false, std::memory_order_seq_cst);
+        //! a producer which saw the asynchronous mode must be done with its slot before the last records are written
+        while (nb_producers_.load(std::memory_order_seq_cst))
+            std::this_thread::yield();
+        {
+            std::lock_guard<std::mutex> wake_up_lock(wake_up_mutex_);
+            stopping_ = true;
+        }
+        wake_up_.notify_one();
+        writer_.join();
+    }
+
+    std::uint64_t nb_dropped() const noexcept
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    template <typename ... Args>
+    void log(log_level level, const char *site, const char *format, Args &&...args)
+    {
+        static_assert(sizeof...(Args) <= log_record::max_args, "too many log arguments");
+        producer_guard producer{nb_producers_};
+        if (!async_.load(std::memory_order_seq_cst)) {
+            log_record record{level, std::chrono::system_clock::now(), site, format, {to_log_arg(std::forward<Args>(args))...}};
+            log_sync(record);
+            return;
+        }
+        auto position = push_position_.load(std::memory_order_relaxed);
+        slot *target;
+        while (true) {
+            target = &ring_[position & ring_mask];
+            auto sequence = target->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::int64_t>(sequence) - static_cast<std::int64_t>(position);
+            if (difference == 0 && push_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+            if (difference < 0) {
+                if (level >= log_level::warning) {
+                    write_record(log_record{level, std::chrono::system_clock::now(), site, format,
+                                            {to_log_arg(std::forward<Args>(args))...}});
+                    return;
+                }
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (difference > 0)
+                position = push_position_.load(std::memory_order_relaxed);
+        }
+        target->record = log_record{level, std::chrono::system_clock::now(), site, format,
+                                    {to_log_arg(std::forward<Args>(args))...}};
+        target->sequence.store(position + 1, std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(wake_up_mutex_);
+            wake_up_.notify_one();
+        }
+    }
+
+    static std::string format(const log_record &record)
+    {
+        std::string line;
+        std::size_t arg_index = 0;
+        for (const char *c = record.format; *c; ++c) {
+            if (c[0] == '{' && c[1] == '}' && arg_index < log_record::max_args) {
+                append_arg(line, record.args[arg_index++]);
+                ++c;
+            } else
+                line += *c;
+        }
+        return line;
+    }
+
+  private:
+    logger() noexcept
+    {
+        for (std::size_t position = 0; position < ring_size; ++position)
+            ring_[position].sequence.store(position, std::memory_order_relaxed);
+    }
+
+    static constexpr std::size_t ring_size = 8192;
+    static constexpr std::size_t ring_mask = ring_size - 1;
+    static constexpr int debug_verbosity = 1;
+
+    //! Counts the calls to log() in progress, for stop_async() to wait for them
+    struct producer_guard
+    {
+      explicit producer_guard(std::atomic<std::uint32_t> &nb_producers) noexcept : nb_producers_{nb_producers}
+      {
+          nb_producers_.fetch_add(1, std::memory_order_seq_cst);
+      }
+
+      ~producer_guard()
+      {
+          nb_producers_.fetch_sub(1, std::memory_order_release);
+      }
+
+      std::atomic<std::uint32_t> &nb_producers_;
+    };
+
+    struct slot
+    {
+      std::atomic<std::uint64_t> sequence;
+      log_record record;
+    };
+
+    template <typename T>
+    static log_arg to_log_arg(T &&value)
+    {
+        using type = std::decay_t<T>;
+        if constexpr (std::is_same_v<type, bool>)
+            return value;
+        else if constexpr (std::is_enum_v<type>)
+            return static_cast<std::int64_t>(value);
+        else if constexpr (std::is_integral_v<type> && std::is_signed_v<type>)
+            return static_cast<std::int64_t>(value);
+        else if constexpr (std::is_integral_v<type>)
+            return static_cast<std::uint64_t>(value);
+        else if constexpr (std::is_floating_point_v<type>)
+            return static_cast<double>(value);
+        else if constexpr (std::is_same_v<type, nlohmann::json>)
+            return nlohmann::json(std::forward<T>(value));
+        else if constexpr (std::is_convertible_v<T, std::string_view>)
+            return std::string(std::string_view(value));
+        else
+            return std::string(std::forward<T>(value));
+    }
+
+    static void append_arg(std::string &line, const log_arg &arg)
+    {
+        std::visit([&line](auto &&value) {
+            using type = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<type, std::monostate>)
+                line += "{}";
+            else if constexpr (std::is_same_v<type, bool>)
+                line += value ? "true" : "false";
+            else if constexpr (std::is_same_v<type, std::string>)
+                line += value;
+            else if constexpr (std::is_same_v<type, nlohmann::json>)
+                line += value.dump();
+            else
+                line += std::to_string(value);
+        }, arg);
+    }
+
+    static void log_sync(const log_record &record)
+    {
+        static constexpr std::array<int, 4> verbosities{debug_verbosity, loguru::Verbosity_INFO,
+                                                        loguru::Verbosity_WARNING, loguru::Verbosity_ERROR};
+        VLOG_F(verbosities[static_cast<std::size_t>(record.level)], "%s: %s", record.site, format(record).c_str());
+    }
+
+    void write_record(const log_record &record)
+    {
+        auto time = std::chrono::system_clock::to_time_t(record.time);
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()) % 1000;
+        std::tm local_time{};
+        localtime_r(&time, &local_time);
+        char time_text[32];
+        std::strftime(time_text, sizeof(time_text), "%H:%M:%S", &local_time);
+        std::fprintf(output_, "%s.%03d %-7s %s: %s\n", time_text, static_cast<int>(milliseconds.count()),
+                     log_level_names[static_cast<std::size_t>(record.level)].data(), record.site, format(record).c_str());
+    }
+
+    bool has_record() const noexcept
+    {
+        return ring_[pop_position_ & ring_mask].sequence.load(std::memory_order_seq_cst) == pop_position_ + 1;
+    }
+
+    bool pop_and_write()
+    {
+        if (!has_record())
+            return false;
+        slot &target = ring_[pop_position_ & ring_mask];
+        write_record(target.record);
+        target.record = log_record{};
+        target.sequence.store(pop_position_ + ring_size, std::memory_order_release);
+        ++pop_position_;
+        return true;
+    }
+
+    void write_records()
+    {
+        while (true) {
+            bool written = false;
+            while (pop_and_write())
+                written = true;
+            if (written)
+                std::fflush(output_);
+            std::unique_lock<std::mutex> lock(wake_up_mutex_);
+            if (stopping_)
+                break;
+            waiting_.store(true, std::memory_order_seq_cst);
+            if (!has_record())
+                wake_up_.wait(lock);
+            waiting_.store(false, std::memory_order_relaxed);
+        }
+        while (pop_and_write());
+        std::fflush(output_);
+    }
+
+    std::atomic<log_level> level_{log_level::info};
+    std::atomic<bool> async_{false};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint32_t> nb_producers_{0};
+    std::array<slot, ring_size> ring_;
+    std::atomic<std::uint64_t> push_position_{0};
+    std::uint64_t pop_position_{0};
+    std::FILE *output_{stderr};
+    std::mutex writer_mutex_;
+    std::thread writer_;
+    std::mutex wake_up_mutex_;
+    std::condition_variable wake_up_;
+    std::atomic<bool> waiting_{false};
+    bool stopping_{false};
+  };
+}
+
+#define RAVEN_LOG(level, ...)                                                                   \
+    do {                                                                                        \
+        if (raven::logger::instance().enabled(raven::log_level::level))                         \
+            raven::logger::instance().log(raven::log_level::level, __func__, __VA_ARGS__);      \
+    } while (false)
+
+//! Logs the enclosing function, at the debug level
+#define RAVEN_LOG_SCOPE()                                                                       \
+    do {                                                                                        \
+        if (raven::logger::instance().enabled(raven::log_level::debug))                         \
+            raven::logger::instance().log(raven::log_level::debug, __PRETTY_FUNCTION__, "");    \
+    } while (false)
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+#include <cstdlib>
+
+TEST_CASE ("logger")
+{
+    auto &logger = raven::logger::instance();
+    auto previous_level = logger.get_level();
+    SUBCASE("arguments are formatted in place of {}") {
+        raven::log_record record{raven::log_level::info, std::chrono::system_clock::now(), "site", "{} and {}: {} {}",
+                                 {std::int64_t{-1}, std::string{"text"}, nlohmann::json{{"KEY", 42}}, true}};
+        CHECK_EQ(raven::logger::format(record), R"(-1 and text: {"KEY":42} true)");
+    }
+    SUBCASE("disabled levels don't evaluate the arguments") {
+        logger.set_level(raven::log_level::warning);
+        bool evaluated = false;
+        auto argument = [&evaluated]() {
+            evaluated = true;
+            return 42;
+        };
+        RAVEN_LOG(info, "{}", argument());
+        CHECK_FALSE(evaluated);
+        RAVEN_LOG(error, "{}", argument());
+        CHECK(evaluated);
+    }
+    SUBCASE("asynchronous mode writes every record") {
+        std::FILE *output = std::tmpfile();
+        REQUIRE(output != nullptr);
+        logger.set_level(raven::log_level::debug);
+        CHECK_GE(loguru::g_stderr_verbosity, 1);
+        logger.start_async(output);
+        for (int i = 0; i < 1000; ++i)
+            RAVEN_LOG(info, "record {}", i);
+        logger.stop_async();
+        std::rewind(output);
+        int nb_lines = 0;
+        for (int c = std::fgetc(output); c != EOF; c = std::fgetc(output))
+            nb_lines += c == '\n';
+        CHECK_EQ(static_cast<std::uint64_t>(nb_lines) + logger.nb_dropped(), 1000u);
+        std::fclose(output);
+    }
+    logger.set_level(previous_level);
+}
+#endif
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <uvw.hpp>
+#include <json.hpp>
+#include "stats.hpp"
+#include "log.hpp"
+
+namespace raven
+{
+  class loop_monitor
+  {
+  public:
+    /*
+     * Lag and saturation of the libuv loop every client shares
+     *
+     * ITERATION_BUSY is the time an iteration kept the loop from polling: the I/O callbacks and the event
+     * fan-out, measured by the service, plus everything between a check and the next prepare (closing handles,
+     * timers). The fan-out has to be measured apart: libuv runs the check handle started last first, and the
+     * service only starts its own once it has events to send, so it runs before the check of the monitor.
+     * TIMER_LAG is how late a repeating timer runs compared to when it was scheduled,
+     * which is what any callback waiting for the loop has to endure.
+     *
+     * Going over the budget is logged as a warning, at most once per warning_interval.
+     * The handles are unreferenced, so they never keep the loop alive.
+     *
+     */
+
+    static constexpr std::chrono::milliseconds probe_interval{100};
+    static constexpr std::chrono::microseconds default_budget{50000};
+    static constexpr std::chrono::seconds warning_interval{1};
+
+    explicit loop_monitor(uvw::Loop &loop, std::chrono::microseconds budget = default_budget) noexcept
+    : prepare_{loop.resource<uvw::PrepareHandle>()}, check_{loop.resource<uvw::CheckHandle>()},
+      probe_{loop.resource<uvw::TimerHandle>()}, budget_{budget}
+    {
+    }
+
+    void start()
+    {
+        prepare_->on<uvw::PrepareEvent>([this](const uvw::PrepareEvent &, uvw::PrepareHandle &) {
+            auto now = stats_clock::now();
+            if (last_check_)
+                this->record_iteration(io_busy_time_ + (now - last_check_.value()));
+            io_busy_time_ = std::chrono::nanoseconds{0};
+        });
+        check_->on<uvw::CheckEvent>([this](const uvw::CheckEvent &, uvw::CheckHandle &) {
+            last_check_ = stats_clock::now();
+        });
+        probe_->on<uvw::TimerEvent>([this](const uvw::TimerEvent &, uvw::TimerHandle &) {
+            auto now = stats_clock::now();
+            this->record_lag(now - (last_probe_ + probe_interval));
+            last_probe_ = now;
+        });
+        prepare_->start();
+        check_->start();
+        last_probe_ = stats_clock::now();
+        probe_->start(uvw::TimerHandle::Time{probe_interval.count()}, uvw::TimerHandle::Time{probe_interval.count()});
+        prepare_->unreference();
+        check_->unreference();
+        probe_->unreference();
+    }
+
+    void close() noexcept
+    {
+        prepare_->close();
+        check_->close();
+        probe_->close();
+    }
+
+    //! Where the service adds the time spent in its I/O callbacks
+    std::chrono::nanoseconds &io_busy_time() noexcept
+    {
+        return io_busy_time_;
+    }
+
+    void set_budget(std::chrono::microseconds budget) noexcept
+    {
+        budget_ = budget;
+    }
+
+    void record_iteration(std::chrono::nanoseconds busy)
+    {
+        iteration_busy_.record(busy);
+        check_budget("iteration busy", busy);
+    }
+
+    void record_lag(std::chrono::nanoseconds lag)
+    {
+        timer_lag_.record(lag);
+        check_budget("timer lag", lag);
+    }
+
+    std::uint64_t nb_over_budget() const noexcept
+    {
+        return nb_over_budget_;
+    }
+
+    nlohmann::json to_json() const
+    {
+        return {{"ITERATIONS",        iteration_busy_.count()},
+                {"ITERATION_BUSY_NS", iteration_busy_.to_json()},
+                {"TIMER_LAG_NS",      timer_lag_.to_json()},
+                {"BUDGET_US",         budget_.count()},
+                {"OVER_BUDGET",       nb_over_budget_}};
+    }
+
+  private:
+    void check_budget(const char *measure, std::chrono::nanoseconds duration)
+    {
+        if (duration <= budget_)
+            return;
+        ++nb_over_budget_;
+        ++nb_unreported_;
+        auto now = stats_clock::now();
+        if (last_warning_ && now - last_warning_.value() < warning_interval)
+            return;
+        RAVEN_LOG(warning, "event loop {} of {} us over the {} us budget, {} time(s) since the last warning",
+                  measure, std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), budget_.count(),
+                  nb_unreported_);
+        last_warning_ = now;
+        nb_unreported_ = 0;
+    }
+
+    std::shared_ptr<uvw::PrepareHandle> prepare_;
+    std::shared_ptr<uvw::CheckHandle> check_;
+    std::shared_ptr<uvw::TimerHandle> probe_;
+    std::chrono::microseconds budget_;
+    std::chrono::nanoseconds io_busy_time_{0};
+    std::optional<stats_clock::time_point> last_check_{std::nullopt};
+    stats_clock::time_point last_probe_;
+    latency_histogram iteration_busy_;
+    latency_histogram timer_lag_;
+    std::uint64_t nb_over_budget_{0};
+    std::uint64_t nb_unreported_{0};
+    std::optional<stats_clock::time_point> last_warning_{std::nullopt};
+  };
+}
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+TEST_CASE ("loop monitor")
+{
+    auto loop = uvw::Loop::create();
+    {
+        raven::loop_monitor monitor{*loop, std::chrono::microseconds(100)};
+        monitor.record_iteration(std::chrono::microseconds(10));
+        monitor.record_lag(std::chrono::microseconds(10));
+        CHECK_EQ(monitor.nb_over_budget(), 0u);
+        monitor.record_iteration(std::chrono::milliseconds(1));
+        monitor.record_lag(std::chrono::milliseconds(1));
+        CHECK_EQ(monitor.nb_over_budget(), 2u);
+        auto loop_stats = monitor.to_json();
+        CHECK_EQ(loop_stats.at("ITERATIONS"), 2);
+        CHECK_EQ(loop_stats.at("TIMER_LAG_NS").at("COUNT"), 2);
+        CHECK_EQ(loop_stats.at("BUDGET_US"), 100);
+        monitor.close();
+        loop->run();
+    }
+    loop->close();
+}
+#endif
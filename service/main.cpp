@@ -1,9 +1,139 @@
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <vector>
 #include "service.hpp"
 
-int main()
+namespace
 {
-  raven::service service;
+  int usage(const char *name)
+  {
+    std::cerr << "usage: " << name << " [--socket PATH]... [--read-only-socket PATH]..."
+              << " [--log-level DEBUG|INFO|WARNING|ERROR|OFF] [--async-log] [--trace]"
+              << " [--slow-request-us MICROSECONDS] [--loop-lag-budget-us MICROSECONDS]"
+              << " [--max-configs-per-client N] [--max-subscriptions-per-client N] [--max-requests-per-second N]"
+              << " [--max-message-bytes N] [--max-output-queue-bytes N] [--max-held-events N] [--stall-timeout-ms MILLISECONDS]"
+              << std::endl;
+    return 1;
+  }
+
+  std::optional<unsigned long long> parse_number(const char *text)
+  {
+    if (!std::isdigit(static_cast<unsigned char>(*text)))
+      return std::nullopt;
+    char *end = nullptr;
+    errno = 0;
+    auto number = std::strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE)
+      return std::nullopt;
+    return number;
+  }
+
+  struct service_options
+  {
+    std::optional<std::chrono::microseconds> slow_request_threshold;
+    std::optional<std::chrono::microseconds> loop_lag_budget;
+    raven::client_limits limits;
+  };
+
+  //! An option taking a number, values over max are refused
+  struct numeric_option
+  {
+    const char *name;
+    unsigned long long max;
+    void (*set)(service_options &options, unsigned long long value);
+  };
+
+  template <typename T>
+  constexpr unsigned long long max_of = static_cast<unsigned long long>(std::numeric_limits<T>::max());
+
+  const numeric_option numeric_options[]{
+    {"--slow-request-us", max_of<std::chrono::microseconds::rep>, [](service_options &options, unsigned long long value) {
+      options.slow_request_threshold = std::chrono::microseconds(value);
+    }},
+    {"--loop-lag-budget-us", max_of<std::chrono::microseconds::rep>, [](service_options &options, unsigned long long value) {
+      options.loop_lag_budget = std::chrono::microseconds(value);
+    }},
+    {"--max-configs-per-client", max_of<std::size_t>, [](service_options &options, unsigned long long value) {
+      options.limits.max_loaded_configs = value;
+    }},
+    {"--max-subscriptions-per-client", max_of<std::size_t>, [](service_options &options, unsigned long long value) {
+      options.limits.max_subscriptions = value;
+    }},
+    {"--max-requests-per-second", max_of<std::uint32_t>, [](service_options &options, unsigned long long value) {
+      options.limits.max_requests_per_second = static_cast<std::uint32_t>(value);
+    }},
+    {"--max-message-bytes", max_of<std::size_t>, [](service_options &options, unsigned long long value) {
+      options.limits.max_message_size = value;
+    }},
+    {"--max-output-queue-bytes", max_of<std::size_t>, [](service_options &options, unsigned long long value) {
+      options.limits.output_high_water_mark = value;
+    }},
+    {"--max-held-events", max_of<std::size_t>, [](service_options &options, unsigned long long value) {
+      options.limits.max_held_events = value;
+    }},
+    {"--stall-timeout-ms", max_of<std::chrono::milliseconds::rep>, [](service_options &options, unsigned long long value) {
+      options.limits.stall_timeout = std::chrono::milliseconds(value);
+    }},
+  };
+
+  const numeric_option *find_numeric_option(const char *name)
+  {
+    for (auto &option : numeric_options)
+      if (std::strcmp(option.name, name) == 0)
+        return &option;
+    return nullptr;
+  }
+}
+
+int main(int ac, char **av)
+{
+  std::vector<raven::listener_config> listeners;
+  service_options options;
+  for (int i = 1; i < ac; ++i) {
+    if (std::strcmp(av[i], "--async-log") == 0) {
+      raven::logger::instance().start_async();
+      continue;
+    }
+    if (std::strcmp(av[i], "--trace") == 0) {
+      raven::tracer::instance().set_enabled(true);
+      continue;
+    }
+    if (i + 1 == ac)
+      return usage(av[0]);
+    if (std::strcmp(av[i], "--log-level") == 0) {
+      auto level = raven::log_level_from_name(av[++i]);
+      if (!level)
+        return usage(av[0]);
+      raven::logger::instance().set_level(level.value());
+      continue;
+    }
+    if (auto option = find_numeric_option(av[i])) {
+      auto number = parse_number(av[++i]);
+      if (!number || number.value() > option->max)
+        return usage(av[0]);
+      option->set(options, number.value());
+      continue;
+    }
+    bool read_only = std::strcmp(av[i], "--read-only-socket") == 0;
+    if (!read_only && std::strcmp(av[i], "--socket") != 0)
+      return usage(av[0]);
+    listeners.push_back({av[++i], read_only ? raven::access_policy::read_only : raven::access_policy::read_write});
+  }
+  if (listeners.empty())
+    listeners.push_back({raven::service::default_socket_path()});
+  raven::service service(std::filesystem::current_path() / "albinos_service.db", listeners);
+  service.set_client_limits(options.limits);
+  if (options.slow_request_threshold)
+    service.set_slow_request_threshold(options.slow_request_threshold.value());
+  if (options.loop_lag_budget)
+    service.set_loop_lag_budget(options.loop_lag_budget.value());
   service.run();
   return 0;
 }
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <optional>
+
+namespace raven
+{
+  class message_buffer
+  {
+  public:
+    /*
+     * Receive buffer of a connection, reused for all its reads
+     *
+     * The socket can read straight into it with prepare() and commit(),
+     * and the messages returned by next() are views into it, valid until the next read.
+     *
+     */
+
+    void feed(const char *data, std::size_t length)
+    {
+        std::memcpy(prepare(length), data, length);
+        commit(length);
+    }
+
+    //! Room for at least length more bytes, once the messages already taken are dropped
+    char *prepare(std::size_t length)
+    {
+        if (begin_ > 0) {
+            std::memmove(data_.get(), data_.get() + begin_, end_ - begin_);
+            end_ -= begin_;
+            scanned_ -= begin_;
+            start_ -= begin_;
+            begin_ = 0;
+        }
+        if (capacity_ - end_ < length) {
+            auto capacity = std::max(capacity_ * 2, end_ + length);
+            auto data = std::make_unique<char[]>(capacity);
+            if (end_)
+                std::memcpy(data.get(), data_.get(), end_);
+            data_ = std::move(data);
+            capacity_ = capacity;
+        }
+        return data_.get() + end_;
+    }
+
+    void commit(std::size_t length) noexcept
+    {
+        end_ += length;
+    }
+
+    std::optional<std::string_view> next()
+    {
+        /*
+         * Extract the next complete json message from the received data
+         *
+         * Messages are not delimited on the socket, so we track the nesting depth outside of strings.
+         * Data that can't start a json value is returned once the next '{' or '[' is received, so that parsing it
+         * reports one error whatever the way it was split across reads.
+         *
+         */
+
+        while (scanned_ < end_) {
+            char c = data_[scanned_];
+            if (depth_ == 0) {
+                bool starts_value = c == '{' || c == '[';
+                if (in_garbage_) {
+                    if (starts_value)
+                        return take(scanned_);
+                    ++scanned_;
+                    continue;
+                }
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                    ++scanned_;
+                    begin_ = scanned_;
+                    continue;
+                }
+                start_ = scanned_;
+                if (!starts_value) {
+                    in_garbage_ = true;
+                    ++scanned_;
+                    continue;
+                }
+            }
+            ++scanned_;
+            if (in_string_) {
+                if (escaped_)
+                    escaped_ = false;
+                else if (c == '\\')
+                    escaped_ = true;
+                else if (c == '"')
+                    in_string_ = false;
+            } else if (c == '"') {
+                in_string_ = true;
+            } else if (c == '{' || c == '[') {
+                ++depth_;
+            } else if ((c == '}' || c == ']') && --depth_ == 0) {
+                return take(scanned_);
+            }
+        }
+        return std::nullopt;
+    }
+
+    //! Bytes received and not taken yet, once next() returned nothing the start of a message
+    std::size_t size() const noexcept
+    {
+        return end_ - begin_;
+    }
+
+  private:
+    std::string_view take(std::size_t end) noexcept
+    {
+        std::string_view message{data_.get() + start_, end - start_};
+        begin_ = end;
+        scanned_ = end;
+        start_ = end;
+        depth_ = 0;
+        in_string_ = false;
+        escaped_ = false;
+        in_garbage_ = false;
+        return message;
+    }
+
+    std::unique_ptr<char[]> data_;
+    std::size_t capacity_{0};
+    //! data_[begin_, end_) is what wasn't taken yet
+    std::size_t begin_{0};
+    std::size_t end_{0};
+    std::size_t scanned_{0};
+    std::size_t start_{0};
+    std::size_t depth_{0};
+    bool in_string_{false};
+    bool escaped_{false};
+    bool in_garbage_{false};
+  };
+}
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+TEST_CASE ("message buffer")
+{
+    raven::message_buffer buffer;
+    SUBCASE("several messages in one read") {
+        std::string data = R"({"REQUEST_NAME": "SETTING_GET"} {"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY": "}{"})";
+        buffer.feed(data.data(), data.size());
+        CHECK_EQ(buffer.next().value(), R"({"REQUEST_NAME": "SETTING_GET"})");
+        CHECK_EQ(buffer.next().value(), R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY": "}{"})");
+        CHECK_FALSE(buffer.next().has_value());
+    }
+    SUBCASE("message split across reads") {
+        std::string first = R"({"SETTINGS_TO_UPDATE": {"foo": "b\"}a)";
+        std::string second = R"(r"}})";
+        buffer.feed(first.data(), first.size());
+        CHECK_FALSE(buffer.next().has_value());
+        buffer.feed(second.data(), second.size());
+        CHECK_EQ(buffer.next().value(), first + second);
+        CHECK_EQ(buffer.size(), 0u);
+    }
+    SUBCASE("garbage is returned as is") {
+        std::string data = R"(hello{"REQUEST_NAME": "SETTING_GET"})";
+        buffer.feed(data.data(), data.size());
+        CHECK_EQ(buffer.next().value(), "hello");
+        CHECK_EQ(buffer.next().value(), R"({"REQUEST_NAME": "SETTING_GET"})");
+    }
+    SUBCASE("garbage is returned whole whatever the reads") {
+        std::string data = R"(garbage[1])";
+        for (auto c : data)
+            buffer.feed(&c, 1);
+        CHECK_EQ(buffer.next().value(), "garbage");
+        CHECK_EQ(buffer.next().value(), "[1]");
+        CHECK_FALSE(buffer.next().has_value());
+    }
+    SUBCASE("reads go straight into the buffer") {
+        std::string first = R"({"REQUEST_NAME": "SETTING_GET"} {"REQUEST)";
+        std::string second = R"(_NAME": "CONFIG_LOAD"})";
+        std::memcpy(buffer.prepare(first.size()), first.data(), first.size());
+        buffer.commit(first.size());
+        CHECK_EQ(buffer.next().value(), R"({"REQUEST_NAME": "SETTING_GET"})");
+        CHECK_FALSE(buffer.next().has_value());
+        std::memcpy(buffer.prepare(4096), second.data(), second.size());
+        buffer.commit(second.size());
+        CHECK_EQ(buffer.next().value(), R"({"REQUEST_NAME": "CONFIG_LOAD"})");
+        CHECK_EQ(buffer.size(), 0u);
+    }
+}
+#endif
@@ -5,8 +5,10 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <json.hpp>
 #include "service_strong_types.hpp"
+#include "json_writer.hpp"
 
 namespace raven
 {
@@ -21,6 +23,7 @@ namespace raven
     unknown_key,
     unknown_setting,
     unknown_alias,
+    limit_exceeded,
     db_error = -1
   };
 
@@ -35,6 +38,7 @@ namespace raven
           {request_state::unknown_key,     "UNKNOWN_KEY"},
           {request_state::unknown_setting, "UNKNOWN_SETTING"},
           {request_state::unknown_alias,   "UNKNOWN_ALIAS"},
+          {request_state::limit_exceeded,  "LIMIT_EXCEEDED"},
           {request_state::db_error,        "DB_ERROR"},
       };
 
@@ -43,6 +47,7 @@ namespace raven
   //! Keywords
   inline constexpr const char request_keyword[] = "REQUEST_NAME";
   inline constexpr const char request_state_keyword[] = "REQUEST_STATE";
+  inline constexpr const char request_id_keyword[] = "REQUEST_ID";
 
   //! Protocol Constants
   inline constexpr const char config_name_keyword[] = "CONFIG_NAME";
@@ -52,9 +57,34 @@ namespace raven
   inline constexpr const char config_include_src[] = "SRC";
   inline constexpr const char setting_name[] = "SETTING_NAME";
   inline constexpr const char settings_to_update_keyword[] = "SETTINGS_TO_UPDATE";
+  inline constexpr const char settings_to_remove_keyword[] = "SETTINGS_TO_REMOVE";
+  inline constexpr const char settings_names_keyword[] = "SETTINGS_NAMES";
+  inline constexpr const char setting_blob_keyword[] = "BLOB";
   //inline constexpr const char setting_value[] = "SETTING_VALUE";
   inline constexpr const char alias_name[] = "ALIAS_NAME";
   inline constexpr const char sub_event_type[] = "SUBSCRIBE_EVENT_TYPE";
+  inline constexpr const char service_stats_keyword[] = "STATS";
+  inline constexpr const char log_level_keyword[] = "LOG_LEVEL";
+  inline constexpr const char trace_enable_keyword[] = "ENABLE";
+  inline constexpr const char trace_events_keyword[] = "TRACE_EVENTS";
+  inline constexpr const char slow_request_threshold_keyword[] = "THRESHOLD_US";
+  inline constexpr const char slow_requests_keyword[] = "SLOW_REQUESTS";
+  inline constexpr const char clients_top_keyword[] = "TOP";
+  inline constexpr const char clients_sort_keyword[] = "SORT_BY";
+  inline constexpr const char clients_keyword[] = "CLIENTS";
+  inline constexpr const char events_dropped_keyword[] = "EVENTS_DROPPED";
+
+  //! Setting values are stored and sent back with their json type:
+  //! a string, a number, a boolean, or a blob: {"BLOB": "<base64 data>"}
+  inline bool is_valid_setting_value(const raven::json::json &value) noexcept
+  {
+      if (value.is_string() || value.is_number() || value.is_boolean())
+          return true;
+      if (!value.is_object() || value.size() != 1)
+          return false;
+      auto blob = value.find(setting_blob_keyword);
+      return blob != value.end() && blob->is_string();
+  }
 
   //! CONFIG_CREATE
   struct config_create
@@ -75,13 +105,20 @@ namespace raven
     std::string request_state;
   };
 
-  void to_json(raven::json::json &json_data, const config_create_answer &cfg)
+  inline void to_json(raven::json::json &json_data, const config_create_answer &cfg)
   {
       json_data = {{"CONFIG_KEY",          cfg.config_key.value()},
                    {"READONLY_CONFIG_KEY", cfg.readonly_config_key.value()},
                    {"REQUEST_STATE",       cfg.request_state}};
   }
 
+  inline void write_json(json_writer &writer, const config_create_answer &cfg)
+  {
+      writer.key("CONFIG_KEY").value(cfg.config_key.value())
+          .key("READONLY_CONFIG_KEY").value(cfg.readonly_config_key.value())
+          .key("REQUEST_STATE").value(cfg.request_state);
+  }
+
   //! CONFIG_LOAD
   struct config_load
   {
@@ -107,13 +144,20 @@ namespace raven
     std::string request_state;
   };
 
-  void to_json(raven::json::json &json_data, const config_load_answer &cfg)
+  inline void to_json(raven::json::json &json_data, const config_load_answer &cfg)
   {
       json_data = {{"CONFIG_NAME",   cfg.config_name},
                    {"CONFIG_ID",     cfg.config_id.value()},
                    {"REQUEST_STATE", cfg.request_state}};
   }
 
+  inline void write_json(json_writer &writer, const config_load_answer &cfg)
+  {
+      writer.key("CONFIG_NAME").value(cfg.config_name)
+          .key("CONFIG_ID").value(static_cast<std::uint64_t>(cfg.config_id.value()))
+          .key("REQUEST_STATE").value(cfg.request_state);
+  }
+
   //! CONFIG_UNLOAD
   struct config_unload
   {
@@ -143,12 +187,15 @@ namespace raven
   {
     config_id_st id;
     json::json settings_to_update{json::json::object()};
+    std::vector<std::string> settings_to_remove;
   };
 
   inline void from_json(const raven::json::json &json_data, setting_update &cfg)
   {
       cfg.id = config_id_st{json_data.at(config_id_keyword).get<std::size_t>()};
       cfg.settings_to_update = json_data.at(settings_to_update_keyword);
+      if (auto to_remove = json_data.find(settings_to_remove_keyword); to_remove != json_data.end())
+          cfg.settings_to_remove = to_remove->get<std::vector<std::string>>();
   }
 
   //! SETTING_REMOVE
@@ -164,6 +211,19 @@ namespace raven
       cfg.setting_name = json_data.at(setting_name).get<std::string>();
   }
 
+  //! SETTINGS_REMOVE
+  struct settings_remove
+  {
+    config_id_st id;
+    std::vector<std::string> settings_names;
+  };
+
+  inline void from_json(const raven::json::json &json_data, settings_remove &cfg)
+  {
+      cfg.id = config_id_st{json_data.at(config_id_keyword).get<std::size_t>()};
+      cfg.settings_names = json_data.at(settings_names_keyword).get<std::vector<std::string>>();
+  }
+
   //! SETTING_GET
   struct setting_get
   {
@@ -180,16 +240,35 @@ namespace raven
   //! SETTING_GET ANSWER
   struct setting_get_answer
   {
-    std::string setting_value;
+    json::json setting_value;
     std::string request_state;
   };
 
-  void to_json(raven::json::json &json_data, const setting_get_answer &cfg)
+  inline void to_json(raven::json::json &json_data, const setting_get_answer &cfg)
   {
       json_data = {{"SETTING_VALUE", cfg.setting_value},
                    {"REQUEST_STATE", cfg.request_state}};
   }
 
+  inline void write_json(json_writer &writer, const setting_get_answer &cfg)
+  {
+      writer.key("SETTING_VALUE").value(cfg.setting_value)
+          .key("REQUEST_STATE").value(cfg.request_state);
+  }
+
+  //! SETTINGS_GET
+  struct settings_get
+  {
+    config_id_st id;
+    std::vector<std::string> settings_names;
+  };
+
+  inline void from_json(const raven::json::json &json_data, settings_get &cfg)
+  {
+      cfg.id = config_id_st{json_data.at(config_id_keyword).get<std::size_t>()};
+      cfg.settings_names = json_data.at(settings_names_keyword).get<std::vector<std::string>>();
+  }
+
   //! CONFIG_GET_SETTINGS_NAMES
   struct config_get_settings_names
   {
@@ -208,12 +287,18 @@ namespace raven
     std::string request_state;
   };
 
-  void to_json(raven::json::json &json_data, const config_get_settings_names_answer &cfg)
+  inline void to_json(raven::json::json &json_data, const config_get_settings_names_answer &cfg)
   {
       json_data = {{"SETTINGS_NAMES", cfg.settings_name},
                    {"REQUEST_STATE", cfg.request_state}};
   }
 
+  inline void write_json(json_writer &writer, const config_get_settings_names_answer &cfg)
+  {
+      writer.key("SETTINGS_NAMES").value(cfg.settings_name)
+          .key("REQUEST_STATE").value(cfg.request_state);
+  }
+
   //! CONFIG_GET_SETTINGS
   struct config_get_settings
   {
@@ -232,12 +317,18 @@ namespace raven
     std::string request_state;
   };
 
-  void to_json(raven::json::json &json_data, const config_get_settings_answer &cfg)
+  inline void to_json(raven::json::json &json_data, const config_get_settings_answer &cfg)
   {
       json_data = {{"SETTINGS", cfg.settings},
                    {"REQUEST_STATE", cfg.request_state}};
   }
 
+  inline void write_json(json_writer &writer, const config_get_settings_answer &cfg)
+  {
+      writer.key("SETTINGS").value(cfg.settings)
+          .key("REQUEST_STATE").value(cfg.request_state);
+  }
+
 
   //! ALIAS_SET
   struct alias_set
@@ -304,6 +395,61 @@ namespace raven
       fill_subscription_struct<setting_unsubscribe>(json_data, std::forward<setting_unsubscribe>(cfg));
   }
 
+  //! SERVICE_LOG_LEVEL
+  struct service_log_level
+  {
+    std::string level;
+  };
+
+  inline void from_json(const raven::json::json &json_data, service_log_level &cfg)
+  {
+      cfg.level = json_data.at(log_level_keyword).get<std::string>();
+  }
+
+  //! SERVICE_TRACE
+  struct service_trace
+  {
+    std::optional<bool> enable{std::nullopt};
+  };
+
+  inline void from_json(const raven::json::json &json_data, service_trace &cfg)
+  {
+      if (auto enable = json_data.find(trace_enable_keyword); enable != json_data.end())
+          cfg.enable = enable->get<bool>();
+  }
+
+  //! SERVICE_SLOW_REQUESTS
+  struct service_slow_requests
+  {
+    //! A null THRESHOLD_US disables the slow request log
+    bool set_threshold{false};
+    std::optional<std::uint64_t> threshold_us{std::nullopt};
+  };
+
+  inline void from_json(const raven::json::json &json_data, service_slow_requests &cfg)
+  {
+      if (auto threshold = json_data.find(slow_request_threshold_keyword); threshold != json_data.end()) {
+          cfg.set_threshold = true;
+          if (!threshold->is_null())
+              cfg.threshold_us = threshold->get<std::uint64_t>();
+      }
+  }
+
+  //! SERVICE_CLIENTS
+  struct service_clients
+  {
+    std::size_t top{10};
+    std::string sort_by{"REQUESTS"};
+  };
+
+  inline void from_json(const raven::json::json &json_data, service_clients &cfg)
+  {
+      if (auto top = json_data.find(clients_top_keyword); top != json_data.end())
+          cfg.top = top->get<std::size_t>();
+      if (auto sort_by = json_data.find(clients_sort_keyword); sort_by != json_data.end())
+          cfg.sort_by = sort_by->get<std::string>();
+  }
+
   enum class subscribe_event_type : short
   {
     update_setting,
@@ -328,7 +474,7 @@ namespace raven
           cfg.type = subscribe_event_type::delete_setting;
   }
 
-  void to_json(raven::json::json &json_data, const subscribe_event &cfg)
+  inline void to_json(raven::json::json &json_data, const subscribe_event &cfg)
   {
       std::string type = "DELETE";
       if (cfg.type == subscribe_event_type::update_setting)
@@ -337,4 +483,11 @@ namespace raven
                    {"SETTING_NAME", cfg.setting_name},
                    {"SUBSCRIPTION_EVENT_TYPE", type}};
   }
+
+  inline void write_json(json_writer &writer, const subscribe_event &cfg)
+  {
+      writer.key("CONFIG_ID").value(static_cast<std::uint64_t>(cfg.id.value()))
+          .key("SETTING_NAME").value(cfg.setting_name)
+          .key("SUBSCRIPTION_EVENT_TYPE").value(cfg.type == subscribe_event_type::update_setting ? "UPDATE" : "DELETE");
+  }
 }
@@ -4,8 +4,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <utility>
 #include <unordered_map>
+#include <unordered_set>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <optional>
+#include <tuple>
+#include <vector>
 #include <sstream>
 #include <iomanip>
 #include <filesystem>
@@ -13,85 +21,53 @@
 #include <uv.h>
 #include <loguru.hpp>
 #include "client.hpp"
+#include "settings_interner.hpp"
 #include "protocol.hpp"
 #include "db.hpp"
+#include "stats.hpp"
+#include "log.hpp"
+#include "trace.hpp"
+#include "loop_monitor.hpp"
+#include "buffer_pool.hpp"
 
 namespace raven
 {
+  //! A socket the service listens on
+  struct listener_config
+  {
+    std::filesystem::path socket_path;
+    access_policy access{access_policy::read_write};
+    //! Permissions of the socket file, which decide who can connect. Left to the umask if not set.
+    std::optional<std::filesystem::perms> permissions{std::nullopt};
+  };
+
   class service
   {
   public:
-    explicit service(std::filesystem::path db_path = std::filesystem::current_path() / "albinos_service.db") noexcept
-    : db_{std::move(db_path)}
+    explicit service(std::filesystem::path db_path = std::filesystem::current_path() / "albinos_service.db",
+                     std::filesystem::path socket_path = default_socket_path(),
+                     std::shared_ptr<uvw::Loop> loop = uvw::Loop::getDefault()) noexcept
+    : service(std::move(db_path), std::vector<listener_config>{{std::move(socket_path)}}, std::move(loop))
     {
-        VLOG_SCOPE_F(loguru::Verbosity_INFO, "service constructor");
-        DVLOG_F(loguru::Verbosity_INFO, "registering error_event libuv listener");
-        server_->on<uvw::ErrorEvent>([this](auto const &error_event, auto &) {
-            LOG_SCOPE_F(ERROR, __PRETTY_FUNCTION__);
-            DVLOG_F(loguru::Verbosity_ERROR, "%s", error_event.what());
-            this->error_occurred = true;
-        });
-        DVLOG_F(loguru::Verbosity_INFO, "registering listen_event libuv listener");
-        server_->on<uvw::ListenEvent>([this](uvw::ListenEvent const &, uvw::PipeHandle &handle) {
-            LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
-            std::shared_ptr<uvw::PipeHandle> socket = handle.loop().resource<uvw::PipeHandle>();
-            DVLOG_F(loguru::Verbosity_INFO, "registering close_event libuv listener");
-            socket->on<uvw::CloseEvent>([this](uvw::CloseEvent const &, uvw::PipeHandle &handle) {
-                LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
-                DVLOG_F(loguru::Verbosity_INFO, "socket closed.");
-                handle.close();
-#ifdef DOCTEST_LIBRARY_INCLUDED
-                this->uv_loop_->stop();
-#endif
-            });
-
-            DVLOG_F(loguru::Verbosity_INFO, "registering end_event libuv listener");
-            socket->on<uvw::EndEvent>([this](const uvw::EndEvent &, uvw::PipeHandle &sock) {
-                LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
-                DVLOG_F(loguru::Verbosity_INFO, "closing socket: %d", static_cast<int>(sock.fileno()));
-                //! Since the client will disconnect, we unload every config related to him
-                DVLOG_F(loguru::Verbosity_INFO, "unload every config for the client -> %d",
-                        static_cast<int>(sock.fileno()));
-                this->config_clients_registry_.erase(sock.fileno());
-                sock.close();
-            });
-
-            DVLOG_F(loguru::Verbosity_INFO, "registering data_event libuv listener");
-            socket->on<uvw::DataEvent>([this](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
-                LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
-                std::string_view data_str(data.data.get(), data.length);
-                try {
-                    auto json_data = json::json::parse(data_str);
-                    auto command_order = json_data.at(raven::request_keyword).get<std::string>();
-                    order_registry.at(command_order)(json_data, sock);
-                }
-                catch (const std::out_of_range &error) {
-                    DVLOG_F(loguru::Verbosity_ERROR, "error in received data: %s", error.what());
-                    json::json unknown_request_data = R"(
-                                                          {"REQUEST_STATE": "UNKNOWN_REQUEST"}
-                                                        )"_json;
-                    sock.write(unknown_request_data.dump().data(),
-                               static_cast<unsigned int>(unknown_request_data.dump().size()));
-                }
-                catch (const std::exception &error) {
-                    DVLOG_F(loguru::Verbosity_ERROR, "error in received data: %s", error.what());
-                    json::json internal_error_request_data = R"(
-                                                          {"REQUEST_STATE": "INTERNAL_ERROR"}
-                                                        )"_json;
-                    sock.write(internal_error_request_data.dump().data(),
-                               static_cast<unsigned int>(internal_error_request_data.dump().size()));
-                }
-            });
+    }
 
-            handle.accept(*socket);
-            config_clients_registry_.emplace(socket->fileno(), raven::client(socket));
-            socket->read();
+    service(std::filesystem::path db_path, const std::vector<listener_config> &listeners,
+            std::shared_ptr<uvw::Loop> loop = uvw::Loop::getDefault()) noexcept
+    : uv_loop_{std::move(loop)}, db_{std::move(db_path)}
+    {
+        VLOG_SCOPE_F(loguru::Verbosity_INFO, "service constructor");
+        for (auto &config : listeners)
+            add_listener(config);
+        DVLOG_F(loguru::Verbosity_INFO, "registering check_event libuv listener");
+        fan_out_->on<uvw::CheckEvent>([this](const uvw::CheckEvent &, uvw::CheckHandle &) {
+            this->flush_events();
         });
+        loop_monitor_.start();
     }
 
     ~service() noexcept
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         DVLOG_F(loguru::Verbosity_INFO, "destroy service");
     }
 
@@ -102,65 +78,590 @@ namespace raven
         run_loop();
     }
 
+    //! ALBINOS_SOCKET_PATH if set, which libalbinos honors too
+    static std::filesystem::path default_socket_path()
+    {
+        if (const char *socket_path = std::getenv("ALBINOS_SOCKET_PATH"); socket_path && *socket_path)
+            return socket_path;
+        return std::filesystem::temp_directory_path() / "raven-os_service_albinos.sock";
+    }
+
+    //! Path of the first listener
+    const std::filesystem::path &socket_path() const noexcept
+    {
+        return listeners_.front().config.socket_path;
+    }
+
+    //! Requests slower than threshold are logged and kept for SERVICE_SLOW_REQUESTS
+    void set_slow_request_threshold(std::chrono::microseconds threshold) noexcept
+    {
+        slow_requests_.set_threshold(threshold);
+    }
+
+    //! Applied to every client, connected or not yet
+    void set_client_limits(const client_limits &limits) noexcept
+    {
+        limits_ = limits;
+    }
+
+    //! Iterations or timer lags over budget are logged as warnings
+    void set_loop_lag_budget(std::chrono::microseconds budget) noexcept
+    {
+        loop_monitor_.set_budget(budget);
+    }
+
+    //! Embedded mode: the caller owns the loop, so these only set things up and return
+
+    //! Listen on the socket path, return false on error
+    bool listen() noexcept
+    {
+        clean_socket();
+        return !create_socket();
+    }
+
+    //! Serve a client already connected to fd, like one end of a socketpair
+    void add_client(uvw::OSFileDescriptor::Type fd, access_policy access = access_policy::read_write)
+    {
+        RAVEN_LOG_SCOPE();
+        std::shared_ptr<uvw::PipeHandle> socket = uv_loop_->resource<uvw::PipeHandle>();
+        socket->open(fd);
+        register_client(std::move(socket), access);
+    }
+
+    //! Close every handle of the service, so that its loop can end
+    void shutdown() noexcept
+    {
+        RAVEN_LOG_SCOPE();
+        for (auto &[fileno, client] : config_clients_registry_)
+            client.get_socket()->close();
+        config_clients_registry_.clear();
+        pending_events_.clear();
+        fan_out_->close();
+        loop_monitor_.close();
+        for (auto &listener : listeners_)
+            listener.server->close();
+        clean_socket();
+    }
+
   private:
     void run_loop()
     {
         uv_loop_->run();
     }
 
+    void add_listener(const listener_config &config)
+    {
+        DVLOG_F(loguru::Verbosity_INFO, "adding listener: %s", config.socket_path.string().c_str());
+        auto server = uv_loop_->resource<uvw::PipeHandle>();
+        DVLOG_F(loguru::Verbosity_INFO, "registering error_event libuv listener");
+        server->on<uvw::ErrorEvent>([this](auto const &error_event, auto &) {
+            LOG_SCOPE_F(ERROR, __PRETTY_FUNCTION__);
+            DVLOG_F(loguru::Verbosity_ERROR, "%s", error_event.what());
+            this->error_occurred = true;
+        });
+        DVLOG_F(loguru::Verbosity_INFO, "registering listen_event libuv listener");
+        server->on<uvw::ListenEvent>([this, access = config.access](uvw::ListenEvent const &, uvw::PipeHandle &handle) {
+            RAVEN_LOG_SCOPE();
+            std::shared_ptr<uvw::PipeHandle> socket = handle.loop().resource<uvw::PipeHandle>();
+            handle.accept(*socket);
+            this->register_client(std::move(socket), access);
+        });
+        listeners_.push_back({config, std::move(server)});
+    }
+
+    void register_client(std::shared_ptr<uvw::PipeHandle> socket, access_policy access)
+    {
+        DVLOG_F(loguru::Verbosity_INFO, "registering close_event libuv listener");
+        socket->on<uvw::CloseEvent>([this](uvw::CloseEvent const &, uvw::PipeHandle &handle) {
+            RAVEN_LOG_SCOPE();
+            DVLOG_F(loguru::Verbosity_INFO, "socket closed.");
+            handle.close();
+#ifdef DOCTEST_LIBRARY_INCLUDED
+            this->uv_loop_->stop();
+#endif
+        });
+
+        config_clients_registry_.emplace(socket->fileno(), raven::client(socket, access));
+        start_reading(*socket);
+    }
+
+    void start_reading(uvw::PipeHandle &socket)
+    {
+        /*
+         * Read through libuv directly rather than with PipeHandle::read(), which allocates a buffer for every read
+         *
+         * libuv reads straight into the receive buffer of the client, and the messages are parsed from it in place.
+         * The service is found back through the user data of the handle, which doesn't own it.
+         *
+         */
+
+        socket.data(std::shared_ptr<service>(std::shared_ptr<service>{}, this));
+        uv_read_start(reinterpret_cast<uv_stream_t *>(socket.raw()), [](uv_handle_t *handle, std::size_t, uv_buf_t *buf) {
+            auto &sock = *static_cast<uvw::PipeHandle *>(handle->data);
+            auto &clients = sock.data<service>()->config_clients_registry_;
+            auto client = clients.find(sock.fileno());
+            if (client == clients.end()) {
+                *buf = uv_buf_init(nullptr, 0);
+                return;
+            }
+            *buf = uv_buf_init(client->second.get_read_buffer().prepare(read_size), static_cast<unsigned int>(read_size));
+        }, [](uv_stream_t *stream, ssize_t nread, const uv_buf_t *) {
+            auto &sock = *static_cast<uvw::PipeHandle *>(stream->data);
+            auto self = sock.data<service>();
+            if (nread > 0)
+                self->on_data(sock, static_cast<std::size_t>(nread));
+            else if (nread < 0)
+                self->on_end(sock);
+        });
+    }
+
+    void on_data(uvw::PipeHandle &sock, std::size_t length)
+    {
+        RAVEN_LOG_SCOPE();
+        scoped_duration busy{loop_monitor_.io_busy_time()};
+        auto &client = config_clients_registry_.at(sock.fileno());
+        client.get_usage().bytes_in += length;
+        auto &read_buffer = client.get_read_buffer();
+        read_buffer.commit(length);
+        while (auto message = read_buffer.next()) {
+            handle_message(message.value(), sock);
+        }
+        //! what is left is the start of a message, which must not grow the buffer forever
+        if (limits_.max_message_size && read_buffer.size() > limits_.max_message_size) {
+            RAVEN_LOG(warning, "disconnecting client {}, its message is over {} bytes", static_cast<int>(sock.fileno()),
+                      limits_.max_message_size);
+            disconnect(sock.fileno());
+        }
+    }
+
+    //! End of the stream, or a read error
+    void on_end(uvw::PipeHandle &sock)
+    {
+        RAVEN_LOG_SCOPE();
+        DVLOG_F(loguru::Verbosity_INFO, "closing socket: %d", static_cast<int>(sock.fileno()));
+        //! Since the client will disconnect, we unload every config related to him
+        DVLOG_F(loguru::Verbosity_INFO, "unload every config for the client -> %d",
+                static_cast<int>(sock.fileno()));
+        pending_events_.erase(sock.fileno());
+        if (auto client_it = config_clients_registry_.find(sock.fileno()); client_it != config_clients_registry_.end()) {
+            release_subscriptions(client_it->second);
+            config_clients_registry_.erase(client_it);
+        }
+        sock.close();
+    }
+
     bool clean_socket() noexcept
     {
-        if (std::filesystem::exists(socket_path_)) {
-            LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
-            DVLOG_F(loguru::Verbosity_WARNING, "socket: %s already exist, removing", socket_path_.string().c_str());
-            std::filesystem::remove(socket_path_);
-            return true;
+        bool removed = false;
+        for (auto &listener : listeners_) {
+            const auto &socket_path = listener.config.socket_path;
+            std::error_code error;
+            if (std::filesystem::exists(socket_path, error)) {
+                RAVEN_LOG_SCOPE();
+                DVLOG_F(loguru::Verbosity_WARNING, "socket: %s already exist, removing", socket_path.string().c_str());
+                std::filesystem::remove(socket_path, error);
+                removed = true;
+            }
         }
-        return false;
+        return removed;
     }
 
     bool create_socket() noexcept
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
-        std::string socket = socket_path_.string();
-        DVLOG_F(loguru::Verbosity_INFO, "binding to socket: %s", socket.c_str());
-        server_->bind(socket);
-        DLOG_IF_F(ERROR, this->error_occurred, "an error occurred during the bind");
-        if (this->error_occurred) return this->error_occurred;
-        server_->listen();
-        DLOG_IF_F(ERROR, this->error_occurred, "an error occurred during the listen");
+        RAVEN_LOG_SCOPE();
+        for (auto &listener : listeners_) {
+            std::string socket = listener.config.socket_path.string();
+            DVLOG_F(loguru::Verbosity_INFO, "binding to socket: %s", socket.c_str());
+            listener.server->bind(socket);
+            DLOG_IF_F(ERROR, this->error_occurred, "an error occurred during the bind");
+            if (this->error_occurred) return this->error_occurred;
+            if (listener.config.permissions) {
+                std::error_code error;
+                std::filesystem::permissions(listener.config.socket_path, listener.config.permissions.value(), error);
+                DLOG_IF_F(ERROR, static_cast<bool>(error), "cannot set the permissions of: %s", socket.c_str());
+            }
+            listener.server->listen();
+            DLOG_IF_F(ERROR, this->error_occurred, "an error occurred during the listen");
+            if (this->error_occurred) return this->error_occurred;
+        }
         return this->error_occurred;
     }
 
+    void handle_message(std::string_view data_str, uvw::PipeHandle &sock)
+    {
+        auto start = stats_clock::now();
+        auto db_busy_time = db_.busy_time();
+        current_timings_ = request_timings{};
+        std::string command;
+        std::string trace_id;
+        std::optional<std::uint64_t> config_id;
+        auto &client = config_clients_registry_.at(sock.fileno());
+        ++client.get_usage().nb_requests;
+        current_request_id_.reset();
+        try {
+            json::json json_data;
+            {
+                scoped_duration parse{current_timings_.parse};
+                json_data = json::json::parse(data_str);
+            }
+            if (auto id = json_data.find(config_id_keyword); id != json_data.end() && id->is_number_unsigned())
+                config_id = id->get<std::uint64_t>();
+            if (auto request_id = json_data.find(request_id_keyword); request_id != json_data.end())
+                current_request_id_ = *request_id;
+            if (auto traced = json_data.find(trace_id_keyword); traced != json_data.end() && traced->is_string()
+                && tracer::instance().enabled()) {
+                trace_id = traced->get<std::string>();
+                tracer::instance().record_flow_step(trace_id, start);
+            }
+            auto command_order = json_data.at(raven::request_keyword).get<std::string>();
+            auto &order = order_registry.at(command_order);
+            command = std::move(command_order);
+            if (!client.take_request_token(limits_, start)) {
+                RAVEN_LOG(info, "client over its request rate: {}", static_cast<int>(sock.fileno()));
+                reject_over_limit(sock);
+            } else if (client.get_access() == access_policy::read_only && is_modifying(command, json_data)) {
+                RAVEN_LOG(info, "read-only client can't send: {}", command);
+                send_answer(sock, request_state::unauthorized);
+            } else
+                order(json_data, sock);
+        }
+        catch (const std::out_of_range &error) {
+            RAVEN_LOG(error, "error in received data: {}", error.what());
+            send_answer(sock, request_state::unknown_request);
+        }
+        catch (const std::exception &error) {
+            RAVEN_LOG(error, "error in received data: {}", error.what());
+            send_answer(sock, request_state::internal_error);
+        }
+        current_request_id_.reset();
+        //! unknown names are gathered, so that a client can't grow the stats
+        current_timings_.db = db_.busy_time() - db_busy_time;
+        auto end = stats_clock::now();
+        const auto &stats_name = command.empty() ? invalid_request_stats_name : command;
+        stats_.record(stats_name, end - start, current_timings_);
+        if (slow_requests_.is_slow(end - start)) {
+            auto &entry = slow_requests_.record({stats_name, config_id, data_str.size(), std::chrono::system_clock::now(),
+                                                 end - start, current_timings_});
+            RAVEN_LOG(warning, "slow request: {}", entry.to_json());
+        }
+        if (tracer::instance().enabled())
+            tracer::instance().record_span(stats_name, "request", start, end, std::move(trace_id));
+    }
+
     //! Helpers
-    static void send_json_answer(json::json &response_json_data, uvw::PipeHandle &sock) noexcept
+    struct write_request
+    {
+      uv_write_t req;
+      service *owner;
+      //! An answer, serialized into a pooled buffer
+      std::string owned;
+      //! Events, shared between the clients receiving them
+      std::vector<std::shared_ptr<const std::string>> payloads;
+      std::vector<uv_buf_t> bufs;
+    };
+
+    write_request *acquire_write_request()
+    {
+        if (free_write_requests_.empty())
+            return new write_request{{}, this, {}, {}, {}};
+        auto request = free_write_requests_.back().release();
+        free_write_requests_.pop_back();
+        return request;
+    }
+
+    void release_write_request(write_request *request) noexcept
+    {
+        buffers_.release(std::exchange(request->owned, std::string{}));
+        request->payloads.clear();
+        request->bufs.clear();
+        if (free_write_requests_.size() < buffer_pool::max_free_per_class)
+            free_write_requests_.emplace_back(request);
+        else
+            delete request;
+    }
+
+    void submit_write(uvw::PipeHandle &sock, write_request *request) noexcept
+    {
+        /*
+         * Write the answer and every payload of the request to the socket with a single uv_write call
+         *
+         * libuv owns the request until the write completes, then its buffers and itself go back to their pools.
+         * The payloads are shared, so the same serialized event can be sent to several clients
+         *
+         */
+
+        if (!request->owned.empty())
+            request->bufs.push_back(uv_buf_init(request->owned.data(), static_cast<unsigned int>(request->owned.size())));
+        for (auto &payload : request->payloads) {
+            request->bufs.push_back(uv_buf_init(const_cast<char *>(payload->data()),
+                                                static_cast<unsigned int>(payload->size())));
+        }
+        request->req.data = request;
+        auto error = uv_write(&request->req, reinterpret_cast<uv_stream_t *>(sock.raw()), request->bufs.data(),
+                              static_cast<unsigned int>(request->bufs.size()), [](uv_write_t *req, int) {
+                auto request = static_cast<write_request *>(req->data);
+                request->owner->release_write_request(request);
+            });
+        if (error) {
+            DVLOG_F(loguru::Verbosity_ERROR, "write failed: %s", uv_strerror(error));
+            release_write_request(request);
+        }
+    }
+
+    void send_json_answer(json::json &response_json_data, uvw::PipeHandle &sock) noexcept
     {
-        auto response_str = response_json_data.dump();
-        sock.write(response_str.data(), static_cast<unsigned int>(response_str.size()));
+        /*
+         * If the request carried a REQUEST_ID, it is echoed back so that a client
+         * multiplexing several requests on one socket can match the answer.
+         */
+        if (current_request_id_)
+            response_json_data[request_id_keyword] = current_request_id_.value();
+        if (auto state = response_json_data.find(request_state_keyword); state != response_json_data.end() && state->is_string())
+            current_timings_.state = state->get_ref<const std::string &>();
+        std::string response_str = buffers_.acquire();
+        {
+            trace_span serialization_span{"serialization", "service"};
+            scoped_duration serialization{current_timings_.serialization};
+            dump_to(response_str, response_json_data);
+        }
+        auto request = acquire_write_request();
+        request->owned = std::move(response_str);
+        write_answer(sock, request);
     }
 
     template <typename ProtocolType>
-    static void send_answer(uvw::PipeHandle &sock, const ProtocolType &answer) noexcept
+    void send_answer(uvw::PipeHandle &sock, const ProtocolType &answer) noexcept
+    {
+        //! Protocol answers are written straight into the output buffer, without building a json::json
+        current_timings_.state = answer.request_state;
+        std::string response_str = buffers_.acquire();
+        {
+            trace_span serialization_span{"serialization", "service"};
+            scoped_duration serialization{current_timings_.serialization};
+            json_writer writer{response_str};
+            writer.begin_object();
+            write_json(writer, answer);
+            if (current_request_id_)
+                writer.key(request_id_keyword).value(current_request_id_.value());
+            writer.end_object();
+        }
+        auto request = acquire_write_request();
+        request->owned = std::move(response_str);
+        write_answer(sock, request);
+    }
+
+    void send_answer(uvw::PipeHandle &sock, request_state state = request_state::success) noexcept
+    {
+        /*
+         * Answers made of a REQUEST_STATE alone are serialized once for all.
+         * Without a REQUEST_ID the constant is handed to libuv as it is, shared by every write,
+         * otherwise the REQUEST_ID is appended to its prefix in a pooled buffer.
+         *
+         */
+
+        static const auto constant_answers = [] {
+            std::unordered_map<request_state, std::shared_ptr<const std::string>> answers;
+            for (const auto &[constant_state, name] : convert_request_state) {
+                std::string answer;
+                json_writer writer{answer};
+                writer.begin_object().key(request_state_keyword).value(name).end_object();
+                answers.emplace(constant_state, std::make_shared<const std::string>(std::move(answer)));
+            }
+            return answers;
+        }();
+        const auto &constant = constant_answers.at(state);
+        current_timings_.state = convert_request_state.at(state);
+        auto request = acquire_write_request();
+        if (!current_request_id_)
+            request->payloads.push_back(constant);
+        else {
+            trace_span serialization_span{"serialization", "service"};
+            scoped_duration serialization{current_timings_.serialization};
+            request->owned = buffers_.acquire();
+            request->owned.append(*constant, 0, constant->size() - 1);
+            request->owned += ',';
+            json_writer writer{request->owned};
+            writer.key(request_id_keyword).value(current_request_id_.value()).end_object();
+        }
+        write_answer(sock, request);
+    }
+
+    void write_answer(uvw::PipeHandle &sock, write_request *request) noexcept
+    {
+        auto client = config_clients_registry_.find(sock.fileno());
+        if (client != config_clients_registry_.end()) {
+            auto &usage = client->second.get_usage();
+            usage.bytes_out += request->owned.size();
+            for (const auto &payload : request->payloads)
+                usage.bytes_out += payload->size();
+        }
+        {
+            trace_span write_span{"write", "service"};
+            scoped_duration write{current_timings_.write};
+            //! the buffer goes to libuv, and back to the pool once the answer is written
+            submit_write(sock, request);
+        }
+        //! answers are never held back, but a client not reading them is watched by the fan-out like a held back one
+        if (client != config_clients_registry_.end() && client->second.is_backlogged(limits_, stats_clock::now())) {
+            pending_events_[sock.fileno()];
+            if (!fan_out_->active())
+                fan_out_->start();
+        }
+    }
+
+    //! Answer LIMIT_EXCEEDED, and count it
+    void reject_over_limit(uvw::PipeHandle &sock) noexcept
+    {
+        ++config_clients_registry_.at(sock.fileno()).get_usage().nb_rejected;
+        send_answer(sock, request_state::limit_exceeded);
+    }
+
+    static bool reached(std::size_t count, std::size_t limit) noexcept
+    {
+        return limit && count >= limit;
+    }
+
+    //! Notifications
+    void queue_event(raven::client &client, subscribe_event &&event)
     {
-        json::json response_json_data;
-        to_json(response_json_data, answer);
-        send_json_answer(response_json_data, sock);
+        pending_events_[client.get_socket()->fileno()].push_back(std::move(event));
+        if (!fan_out_->active())
+            fan_out_->start();
     }
 
-    static void send_answer(uvw::PipeHandle &sock, request_state state = request_state::success) noexcept
+    //! Keep only the last event of each setting, in the order of these last events, return how many were merged
+    static std::size_t coalesce_events(std::vector<subscribe_event> &events)
     {
-        json::json response_json_data;
-        response_json_data[request_state_keyword] = convert_request_state.at(state);
-        send_json_answer(response_json_data, sock);
+        std::set<std::pair<config_id_st::value_type, std::string>> seen;
+        std::vector<subscribe_event> coalesced;
+        coalesced.reserve(events.size());
+        for (auto it = events.rbegin(); it != events.rend(); ++it) {
+            if (seen.emplace(it->id.value(), it->setting_name).second)
+                coalesced.push_back(std::move(*it));
+        }
+        std::reverse(coalesced.begin(), coalesced.end());
+        auto nb_merged = events.size() - coalesced.size();
+        events = std::move(coalesced);
+        return nb_merged;
+    }
+
+    //! Keep the latest max_held_events events, return how many were dropped
+    static std::size_t drop_oldest_events(std::vector<subscribe_event> &events, std::size_t max_held_events)
+    {
+        if (!max_held_events || events.size() <= max_held_events)
+            return 0;
+        auto nb_dropped = events.size() - max_held_events;
+        events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(nb_dropped));
+        return nb_dropped;
+    }
+
+    //! Give back the setting ids held by the subscriptions of a client going away
+    void release_subscriptions(const client &client)
+    {
+        client.for_each_subscription([this](setting_id_st setting_id) { settings_ids_.release(setting_id); });
+    }
+
+    //! Same as the client leaving
+    void disconnect(uvw::OSFileDescriptor::Type fileno)
+    {
+        auto client_it = config_clients_registry_.find(fileno);
+        if (client_it == config_clients_registry_.end())
+            return;
+        auto socket = client_it->second.get_socket();
+        pending_events_.erase(fileno);
+        release_subscriptions(client_it->second);
+        config_clients_registry_.erase(client_it);
+        socket->close();
+    }
+
+    void flush_events() noexcept
+    {
+        /*
+         * Fan-out stage, run by the check handle once the current loop iteration has processed its requests
+         *
+         * Each distinct event is serialized once, and every client receives all its pending events in one write
+         *
+         * The events of a client past the output high-water mark are held back instead: only the last event
+         * of each setting is kept, and past max_held_events the oldest ones are dropped. Once the client
+         * catches up, an EVENTS_DROPPED event tells it how many it lost, so that it can reload its settings.
+         * A client staying past the mark for stall_timeout is disconnected.
+         *
+         */
+
+        RAVEN_LOG_SCOPE();
+        scoped_duration busy{loop_monitor_.io_busy_time()};
+        trace_span span{"fan_out", "service"};
+        auto now = stats_clock::now();
+        std::map<std::tuple<config_id_st::value_type, std::string, subscribe_event_type>,
+            std::shared_ptr<const std::string>> payloads;
+        std::vector<uvw::OSFileDescriptor::Type> stalled_clients;
+        for (auto it = pending_events_.begin(); it != pending_events_.end();) {
+            auto &[fileno, events] = *it;
+            auto client_it = config_clients_registry_.find(fileno);
+            if (client_it == config_clients_registry_.end()) {
+                it = pending_events_.erase(it);
+                continue;
+            }
+            auto &client = client_it->second;
+            auto &usage = client.get_usage();
+            if (client.is_backlogged(limits_, now)) {
+                usage.events_coalesced += coalesce_events(events);
+                auto nb_dropped = drop_oldest_events(events, limits_.max_held_events);
+                usage.events_dropped += nb_dropped;
+                client.unreported_drops() += nb_dropped;
+                if (client.is_stalled(limits_, now))
+                    stalled_clients.push_back(fileno);
+                ++it;
+                continue;
+            }
+            auto request = acquire_write_request();
+            auto &buffers = request->payloads;
+            buffers.reserve(events.size() + 1);
+            if (client.unreported_drops()) {
+                std::string dropped_str;
+                json_writer writer{dropped_str};
+                writer.begin_object().key(events_dropped_keyword).value(client.unreported_drops());
+                writer.end_object();
+                usage.bytes_out += dropped_str.size();
+                buffers.push_back(std::make_shared<const std::string>(std::move(dropped_str)));
+                client.unreported_drops() = 0;
+            }
+            for (auto &event : events) {
+                auto[payload_it, inserted] = payloads.try_emplace({event.id.value(), event.setting_name, event.type});
+                if (inserted) {
+                    std::string event_str;
+                    json_writer writer{event_str};
+                    writer.begin_object();
+                    write_json(writer, event);
+                    writer.end_object();
+                    payload_it->second = std::make_shared<const std::string>(std::move(event_str));
+                }
+                usage.bytes_out += payload_it->second->size();
+                buffers.push_back(payload_it->second);
+            }
+            DLOG_F(INFO, "flushing %lu events to client: %d", buffers.size(), static_cast<int>(fileno));
+            if (!buffers.empty())
+                submit_write(*client.get_socket(), request);
+            else
+                release_write_request(request);
+            it = pending_events_.erase(it);
+        }
+        for (auto fileno : stalled_clients) {
+            RAVEN_LOG(warning, "disconnecting client {}, stuck past the output high-water mark", static_cast<int>(fileno));
+            disconnect(fileno);
+        }
+        //! held back events are retried at the next iteration, which the client draining its queue will trigger
+        if (pending_events_.empty())
+            fan_out_->stop();
     }
 
     template <typename Request>
     static Request fill_request(json::json &json_data)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         Request request;
         from_json(json_data, request);
-        DLOG_F(INFO, "json receive:%s", json_data.dump().c_str());
+        RAVEN_LOG(debug, "json receive: {}", json_data);
         return request;
     }
 
@@ -182,11 +683,15 @@ namespace raven
 
     void load_config(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<config_load>(json_data);
         DLOG_IF_F(INFO, cfg.config_key.has_value(), "cfg.config_key: %s", cfg.config_key.value().value().c_str());
         DLOG_IF_F(INFO, cfg.config_read_only_key.has_value(), "cfg.config_read_only_key: %s",
                   cfg.config_read_only_key.value().value().c_str());
+        if (reached(config_clients_registry_.at(sock.fileno()).nb_loaded_configs(), limits_.max_loaded_configs)) {
+            reject_over_limit(sock);
+            return ;
+        }
 
         config_id_st id;
         if (cfg.config_key) {
@@ -224,17 +729,18 @@ namespace raven
 
     void unload_config(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<config_unload>(json_data);
         auto &config_ids = config_clients_registry_.at(sock.fileno());
-        config_ids.remove_temp_id(cfg.id);
+        for (auto setting_id : config_ids.remove_temp_id(cfg.id))
+            settings_ids_.release(setting_id_st{setting_id});
         send_answer(sock);
     }
 
     void include_config(json::json &json_data, uvw::PipeHandle &sock)
     {
         //TODO: Communication.md has changed, need to be modified
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<config_include>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
         DLOG_F(INFO, "cfg.src_id: %lu", cfg.src_id.value());
@@ -256,12 +762,41 @@ namespace raven
         send_answer(sock, request_state::success);
     }
 
+    void queue_setting_events(config_id_st db_id, const std::string &setting_name, subscribe_event_type type)
+    {
+        scoped_duration fan_out{current_timings_.fan_out};
+        auto setting_id = settings_ids_.find(setting_name);
+        if (!setting_id)
+            return;
+        for (auto &[fileno, client] : config_clients_registry_) {
+            client.for_each_subscribed_id(db_id, setting_id.value(), [&](config_id_st id) {
+                queue_event(client, subscribe_event{id, setting_name, type});
+            });
+        }
+    }
+
     void update_setting(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        /*
+         * Settings to update and settings to remove are applied with a single update of the stored config,
+         * so a batch of changes is atomic and its events are all sent in the same wave
+         *
+         * Settings to remove which don't exist are ignored, a setting both updated and removed is removed
+         *
+         */
+
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<setting_update>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
-        DLOG_F(INFO, "settings_to_update: %s", cfg.settings_to_update.dump().c_str());
+        RAVEN_LOG(debug, "settings_to_update: {}", cfg.settings_to_update);
+        DLOG_F(INFO, "nb settings to remove: %lu", cfg.settings_to_remove.size());
+        for (auto &[key, value] : cfg.settings_to_update.items()) {
+            if (!is_valid_setting_value(value)) {
+                DLOG_F(INFO, "invalid value for setting: %s", key.c_str());
+                send_answer(sock, request_state::bad_order);
+                return;
+            }
+        }
         if (!config_clients_registry_.at(sock.fileno()).has_loaded(cfg.id)) {
             send_answer(sock, request_state::unknown_id);
             return;
@@ -275,10 +810,16 @@ namespace raven
             return ;
         }
 
+        auto &settings = config_json_data[config_settings_field_keyword];
         for (auto &[key, value] : cfg.settings_to_update.items()) {
-            config_json_data[config_settings_field_keyword][key] = value;
+            settings[key] = value;
         }
-        DLOG_F(INFO, "config after update: %s", config_json_data.dump().c_str());
+        std::vector<std::string> removed_settings;
+        for (auto &setting_name : cfg.settings_to_remove) {
+            if (settings.erase(setting_name) > 0)
+                removed_settings.push_back(setting_name);
+        }
+        RAVEN_LOG(debug, "config after update: {}", config_json_data);
         db_.update_config(config_json_data, db_id);
         if (db_.fail()) {
             send_answer(sock, request_state::db_error);
@@ -288,46 +829,80 @@ namespace raven
         send_answer(sock, request_state::success);
         // TODO : lookup de la db pour associer l'id temporaire du client qui a update au vrai id dans la db puis retrouver l'id temporaire du client courant dans la loop associer a ce vrai id
         // Workaround : get db_id from the client class
-        for (auto &[fileno, client] : config_clients_registry_)
-        {
-            for (auto&[key, value] : cfg.settings_to_update.items()) {
+        for (auto&[key, value] : cfg.settings_to_update.items()) {
+            if (std::find(removed_settings.begin(), removed_settings.end(), key) == removed_settings.end())
+                queue_setting_events(db_id, key, subscribe_event_type::update_setting);
+        }
+        for (auto &setting_name : removed_settings)
+            queue_setting_events(db_id, setting_name, subscribe_event_type::delete_setting);
+    }
 
-                if (client.is_subscribed(db_id, key)) {
-                    const subscribe_event answer{client.get_id_from_db(db_id),
-                                                 key,
-                                                 subscribe_event_type::update_setting};
-                    send_answer(*client.get_socket(), answer);
-                }
+    void remove_settings_from_config(config_id_st id, const std::vector<std::string> &settings_names, uvw::PipeHandle &sock)
+    {
+        /*
+         * Remove every setting of the list from the config, with a single update of the stored config
+         *
+         * Nothing is removed if one of the settings doesn't exist, delete events are queued only once the update succeeded
+         *
+         */
+
+        if (!config_clients_registry_.at(sock.fileno()).has_loaded(id)) {
+            send_answer(sock, request_state::unknown_id);
+            return ;
+        }
+        auto db_id = config_clients_registry_.at(sock.fileno()).get_db_id_from(id);
+        auto config_json_data = db_.get_config(db_id);
+        if (db_.fail()) {
+            send_answer(sock, request_state::db_error);
+            return ;
+        }
+
+        auto &settings = config_json_data[config_settings_field_keyword];
+        for (auto &setting_name : settings_names) {
+            if (settings.count(setting_name) == 0) {
+                DLOG_F(INFO, "unknown setting: %s", setting_name.c_str());
+                send_answer(sock, request_state::unknown_setting);
+                return ;
             }
         }
+        std::vector<std::string> removed_settings;
+        for (auto &setting_name : settings_names) {
+            if (settings.erase(setting_name) > 0)
+                removed_settings.push_back(setting_name);
+        }
+        RAVEN_LOG(debug, "config after remove: {}", config_json_data);
+        db_.update_config(config_json_data, db_id);
+        if (db_.fail()) {
+            send_answer(sock, request_state::db_error);
+            return ;
+        }
+
+        send_answer(sock);
+        for (auto &setting_name : removed_settings)
+            queue_setting_events(db_id, setting_name, subscribe_event_type::delete_setting);
     }
 
     void remove_setting(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<setting_remove>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
         DLOG_F(INFO, "cfg.setting_name: %s", cfg.setting_name.c_str());
-        send_answer(sock);
-        // TODO : lookup de la db pour associer l'id temporaire du client qui a update au vrai id dans la db puis retrouver l'id temporaire du client courant dans la loop associer a ce vrai id
-        // Workaround : get db_id from the client class
-        if (!config_clients_registry_.at(sock.fileno()).has_loaded(cfg.id))
-            return ;
-        auto db_id = config_clients_registry_.at(sock.fileno()).get_db_id_from(cfg.id);
-        for (auto &[fileno, client] : config_clients_registry_)
-        {
-            if (client.is_subscribed(db_id, cfg.setting_name)) {
-                const subscribe_event answer{client.get_id_from_db(db_id),
-                                             cfg.setting_name,
-                                             subscribe_event_type::delete_setting};
-                send_answer(*client.get_socket(), answer);
-            }
-        }
+        remove_settings_from_config(cfg.id, {cfg.setting_name}, sock);
+    }
+
+    void remove_settings(json::json &json_data, uvw::PipeHandle &sock)
+    {
+        RAVEN_LOG_SCOPE();
+        auto cfg = fill_request<settings_remove>(json_data);
+        DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
+        DLOG_F(INFO, "nb settings to remove: %lu", cfg.settings_names.size());
+        remove_settings_from_config(cfg.id, cfg.settings_names, sock);
     }
 
     void get_setting(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<setting_get>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
         DLOG_F(INFO, "cfg.setting_name: %s", cfg.setting_name.c_str());
@@ -352,9 +927,37 @@ namespace raven
         send_answer(sock, answer);
     }
 
+    void get_settings(json::json &json_data, uvw::PipeHandle &sock)
+    {
+        RAVEN_LOG_SCOPE();
+        auto cfg = fill_request<settings_get>(json_data);
+        DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
+        if (!config_clients_registry_.at(sock.fileno()).has_loaded(raven::config_id_st{cfg.id})) {
+            send_answer(sock, request_state::unknown_id);
+            return ;
+        }
+        auto config_json_data = db_.get_config(config_clients_registry_.at(sock.fileno()).get_db_id_from(raven::config_id_st{cfg.id}));
+        if (db_.fail()) {
+            send_answer(sock, request_state::db_error);
+            return ;
+        }
+        /*
+         * Unknown settings are left out of the answer instead of failing the whole request,
+         * the client knows which names it asked for.
+         */
+        auto &settings = config_json_data[config_settings_field_keyword];
+        config_get_settings_answer answer;
+        for (const auto &setting_name : cfg.settings_names) {
+            if (auto setting = settings.find(setting_name); setting != settings.end())
+                answer.settings[setting_name] = *setting;
+        }
+        answer.request_state = convert_request_state.at(request_state::success);
+        send_answer(sock, answer);
+    }
+
     void get_settings_names(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<config_get_settings_names>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
         if (!config_clients_registry_.at(sock.fileno()).has_loaded(raven::config_id_st{cfg.id})) {
@@ -376,7 +979,7 @@ namespace raven
 
     void get_all_settings(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<config_get_settings>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
         if (!config_clients_registry_.at(sock.fileno()).has_loaded(raven::config_id_st{cfg.id})) {
@@ -394,7 +997,7 @@ namespace raven
 
     void set_alias(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<alias_set>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
         DLOG_F(INFO, "cfg.alias_name: %s", cfg.alias_name.c_str());
@@ -404,7 +1007,7 @@ namespace raven
 
     void unset_alias(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<alias_unset>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
         DLOG_F(INFO, "cfg.alias_name: %s", cfg.alias_name.c_str());
@@ -413,7 +1016,7 @@ namespace raven
 
     void subscribe_setting(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<setting_subscribe>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
         DLOG_IF_F(INFO, cfg.setting_name.has_value(), "cfg.setting_name: %s", cfg.setting_name.value().c_str());
@@ -424,7 +1027,16 @@ namespace raven
         }
         if (cfg.setting_name.has_value())
         {
-            config_clients_registry_.at(sock.fileno()).subscribe(cfg.id, cfg.setting_name.value());
+            auto &client = config_clients_registry_.at(sock.fileno());
+            auto setting_id = settings_ids_.find(cfg.setting_name.value());
+            bool subscribed = setting_id && client.is_subscribed(cfg.id, setting_id.value());
+            if (!subscribed && reached(client.nb_subscriptions(), limits_.max_subscriptions)) {
+                reject_over_limit(sock);
+                return ;
+            }
+            //! every subscription holds a reference on the id of its setting
+            if (!subscribed)
+                client.subscribe(cfg.id, settings_ids_.intern(cfg.setting_name.value()));
             // TODO
             // if setting doesn't exist in config
             //      send_answer(sock, request_state::unknown_setting);
@@ -436,7 +1048,7 @@ namespace raven
 
     void unsubscribe_setting(json::json &json_data, uvw::PipeHandle &sock)
     {
-        LOG_SCOPE_F(INFO, __PRETTY_FUNCTION__);
+        RAVEN_LOG_SCOPE();
         auto cfg = fill_request<setting_subscribe>(json_data);
         DLOG_F(INFO, "cfg.id: %lu", cfg.id.value());
         DLOG_IF_F(INFO, cfg.setting_name.has_value(), "cfg.setting_name: %s", cfg.setting_name.value().c_str());
@@ -447,22 +1059,156 @@ namespace raven
         }
         if (cfg.setting_name.has_value())
         {
-            config_clients_registry_.at(sock.fileno()).unsubscribe(cfg.id, cfg.setting_name.value());
+            auto setting_id = settings_ids_.find(cfg.setting_name.value());
+            if (setting_id && config_clients_registry_.at(sock.fileno()).unsubscribe(cfg.id, setting_id.value()))
+                settings_ids_.release(setting_id.value());
             send_answer(sock);
         } else // TODO handle alias case
             send_answer(sock, request_state::internal_error);
     }
 
-    std::shared_ptr<uvw::Loop> uv_loop_{uvw::Loop::getDefault()};
-    std::shared_ptr<uvw::PipeHandle> server_{uv_loop_->resource<uvw::PipeHandle>()};
-    std::filesystem::path socket_path_{(std::filesystem::temp_directory_path() / "raven-os_service_albinos.sock")};
+    void get_service_stats([[maybe_unused]] json::json &json_data, uvw::PipeHandle &sock)
+    {
+        RAVEN_LOG_SCOPE();
+        auto stats = stats_.snapshot();
+        stats["LOOP"] = loop_monitor_.to_json();
+        stats["LOG"] = {{"DROPPED", logger::instance().nb_dropped()}};
+        auto nb_requests = std::max<std::uint64_t>(stats_.nb_requests(), 1);
+        stats["BUFFERS"] = {{"ALLOCATED",               buffers_.nb_allocated()},
+                            {"REUSED",                  buffers_.nb_reused()},
+                            {"POOL_MISSES_PER_REQUEST", static_cast<double>(buffers_.nb_allocated()) / nb_requests}};
+        json::json answer{{request_state_keyword, convert_request_state.at(request_state::success)},
+                          {service_stats_keyword, std::move(stats)}};
+        send_json_answer(answer, sock);
+    }
+
+    void get_clients(json::json &json_data, uvw::PipeHandle &sock)
+    {
+        /*
+         * The clients consuming the most of SORT_BY, TOP of them
+         *
+         * QUEUED_BYTES is what libuv still has to write to the client, QUEUED_EVENTS the events not flushed yet
+         *
+         */
+
+        RAVEN_LOG_SCOPE();
+        auto cfg = fill_request<service_clients>(json_data);
+        static const std::unordered_set<std::string> sort_keys{"REQUESTS", "REJECTED", "BYTES_IN", "BYTES_OUT",
+                                                               "CONFIGS", "SUBSCRIPTIONS", "QUEUED_BYTES",
+                                                               "QUEUED_EVENTS", "EVENTS_COALESCED", "EVENTS_DROPPED"};
+        if (!sort_keys.count(cfg.sort_by)) {
+            send_answer(sock, request_state::bad_order);
+            return;
+        }
+        std::vector<json::json> clients;
+        clients.reserve(config_clients_registry_.size());
+        for (auto &[fileno, client] : config_clients_registry_) {
+            auto &usage = client.get_usage();
+            auto pending = pending_events_.find(fileno);
+            clients.push_back({{"CLIENT",        fileno},
+                               {"READ_ONLY",     client.get_access() == access_policy::read_only},
+                               {"REQUESTS",      usage.nb_requests},
+                               {"REJECTED",      usage.nb_rejected},
+                               {"BYTES_IN",      usage.bytes_in},
+                               {"BYTES_OUT",     usage.bytes_out},
+                               {"CONFIGS",       client.nb_loaded_configs()},
+                               {"SUBSCRIPTIONS", client.nb_subscriptions()},
+                               {"QUEUED_BYTES",  client.get_socket()->writeQueueSize()},
+                               {"QUEUED_EVENTS", pending == pending_events_.end() ? 0 : pending->second.size()},
+                               {"EVENTS_COALESCED", usage.events_coalesced},
+                               {"EVENTS_DROPPED", usage.events_dropped}});
+        }
+        auto top = std::min(cfg.top, clients.size());
+        std::partial_sort(clients.begin(), clients.begin() + static_cast<std::ptrdiff_t>(top), clients.end(),
+                          [&sort_by = cfg.sort_by](const json::json &lhs, const json::json &rhs) {
+                              return lhs.at(sort_by).get<std::uint64_t>() > rhs.at(sort_by).get<std::uint64_t>();
+                          });
+        clients.resize(top);
+        json::json answer{{request_state_keyword, convert_request_state.at(request_state::success)},
+                          {clients_keyword, std::move(clients)}};
+        send_json_answer(answer, sock);
+    }
+
+    void trace(json::json &json_data, uvw::PipeHandle &sock)
+    {
+        RAVEN_LOG_SCOPE();
+        auto cfg = fill_request<service_trace>(json_data);
+        json::json answer{{request_state_keyword, convert_request_state.at(request_state::success)},
+                          {trace_events_keyword, tracer::instance().take_events()}};
+        if (cfg.enable)
+            tracer::instance().set_enabled(cfg.enable.value());
+        send_json_answer(answer, sock);
+    }
+
+    void get_slow_requests(json::json &json_data, uvw::PipeHandle &sock)
+    {
+        RAVEN_LOG_SCOPE();
+        auto cfg = fill_request<service_slow_requests>(json_data);
+        if (cfg.set_threshold) {
+            if (cfg.threshold_us)
+                slow_requests_.set_threshold(std::chrono::microseconds(cfg.threshold_us.value()));
+            else
+                slow_requests_.set_threshold(std::nullopt);
+        }
+        json::json answer{{request_state_keyword, convert_request_state.at(request_state::success)},
+                          {slow_requests_keyword, slow_requests_.to_json()}};
+        send_json_answer(answer, sock);
+    }
+
+    void set_log_level(json::json &json_data, uvw::PipeHandle &sock)
+    {
+        RAVEN_LOG_SCOPE();
+        auto cfg = fill_request<service_log_level>(json_data);
+        auto level = log_level_from_name(cfg.level);
+        if (!level) {
+            send_answer(sock, request_state::bad_order);
+            return;
+        }
+        logger::instance().set_level(level.value());
+        send_answer(sock);
+    }
+
+    std::shared_ptr<uvw::Loop> uv_loop_;
+    std::shared_ptr<uvw::CheckHandle> fan_out_{uv_loop_->resource<uvw::CheckHandle>()};
+    loop_monitor loop_monitor_{*uv_loop_};
+    struct listener
+    {
+      listener_config config;
+      std::shared_ptr<uvw::PipeHandle> server;
+    };
+    std::vector<listener> listeners_;
+    //! Reads are done in chunks of that size, straight into the receive buffer of the client
+    static constexpr std::size_t read_size = 16 * 1024;
+    buffer_pool buffers_;
+    std::vector<std::unique_ptr<write_request>> free_write_requests_;
     std::unordered_map<uvw::OSFileDescriptor::Type, raven::client> config_clients_registry_;
+    std::unordered_map<uvw::OSFileDescriptor::Type, std::vector<subscribe_event>> pending_events_;
+    settings_interner settings_ids_;
+    std::optional<json::json> current_request_id_{std::nullopt};
+    request_timings current_timings_;
+    service_stats stats_;
+    slow_request_log slow_requests_;
+    client_limits limits_;
+    inline static const std::string invalid_request_stats_name{"INVALID_REQUEST"};
     config_db db_;
     bool error_occurred{false};
-    const std::unordered_map<std::string, std::function<void(json::json &, uvw::PipeHandle &)>>
-        order_registry
+    //! Refused to the clients of a read-only listener
+    inline static const std::unordered_set<std::string> modifying_requests
         {
-            {
+            "CONFIG_CREATE", "CONFIG_INCLUDE", "SETTING_UPDATE", "SETTING_REMOVE", "SETTINGS_REMOVE", "ALIAS_SET",
+            "ALIAS_UNSET", "SERVICE_LOG_LEVEL", "SERVICE_TRACE"
+        };
+
+    //! SERVICE_SLOW_REQUESTS only modifies the service when it sets the threshold
+    static bool is_modifying(const std::string &command, const json::json &json_data)
+    {
+        return modifying_requests.count(command) > 0
+               || (command == "SERVICE_SLOW_REQUESTS" && json_data.contains(slow_request_threshold_keyword));
+    }
+    const std::unordered_map<std::string, std::function<void(json::json &, uvw::PipeHandle &)>>
+        order_registry
+        {
+            {
                 "CONFIG_CREATE",       [this](json::json &json_data, uvw::PipeHandle &sock) {
                 this->create_config(json_data, sock);
             }},
@@ -486,10 +1232,18 @@ namespace raven
                 "SETTING_REMOVE",      [this](json::json &json_data, uvw::PipeHandle &sock) {
                 this->remove_setting(json_data, sock);
             }},
+            {
+                "SETTINGS_REMOVE",     [this](json::json &json_data, uvw::PipeHandle &sock) {
+                this->remove_settings(json_data, sock);
+            }},
             {
                 "SETTING_GET",         [this](json::json &json_data, uvw::PipeHandle &sock) {
                 this->get_setting(json_data, sock);
             }},
+            {
+                "SETTINGS_GET",        [this](json::json &json_data, uvw::PipeHandle &sock) {
+                this->get_settings(json_data, sock);
+            }},
             {
                 "CONFIG_GET_SETTINGS",         [this](json::json &json_data, uvw::PipeHandle &sock) {
                 this->get_all_settings(json_data, sock);
@@ -517,15 +1271,74 @@ namespace raven
                 "UNSUBSCRIBE_SETTING", [this](json::json &json_data, uvw::PipeHandle &sock) {
                 this->unsubscribe_setting(json_data, sock);
             },
-            }
+            },
+            {
+                "SERVICE_STATS",       [this](json::json &json_data, uvw::PipeHandle &sock) {
+                this->get_service_stats(json_data, sock);
+            }},
+            {
+                "SERVICE_LOG_LEVEL",   [this](json::json &json_data, uvw::PipeHandle &sock) {
+                this->set_log_level(json_data, sock);
+            }},
+            {
+                "SERVICE_TRACE",       [this](json::json &json_data, uvw::PipeHandle &sock) {
+                this->trace(json_data, sock);
+            }},
+            {
+                "SERVICE_SLOW_REQUESTS", [this](json::json &json_data, uvw::PipeHandle &sock) {
+                this->get_slow_requests(json_data, sock);
+            }},
+            {
+                "SERVICE_CLIENTS",     [this](json::json &json_data, uvw::PipeHandle &sock) {
+                this->get_clients(json_data, sock);
+            }}
         };
 
 #ifdef DOCTEST_LIBRARY_INCLUDED
+    TEST_CASE_CLASS ("coalesce held back events")
+    {
+        std::vector<subscribe_event> events{{config_id_st{1}, "a", subscribe_event_type::update_setting},
+                                            {config_id_st{1}, "b", subscribe_event_type::update_setting},
+                                            {config_id_st{2}, "a", subscribe_event_type::update_setting},
+                                            {config_id_st{1}, "a", subscribe_event_type::delete_setting}};
+        CHECK_EQ(coalesce_events(events), 1u);
+        REQUIRE_EQ(events.size(), 3u);
+        CHECK_EQ(events[0].setting_name, "b");
+        CHECK_EQ(events[1].id.value(), 2u);
+        CHECK_EQ(events[2].setting_name, "a");
+        CHECK(events[2].type == subscribe_event_type::delete_setting);
+        CHECK_EQ(coalesce_events(events), 0u);
+        CHECK_EQ(drop_oldest_events(events, 3), 0u);
+        CHECK_EQ(drop_oldest_events(events, 0), 0u);
+        CHECK_EQ(drop_oldest_events(events, 1), 2u);
+        REQUIRE_EQ(events.size(), 1u);
+        CHECK_EQ(events[0].setting_name, "a");
+        CHECK(events[0].type == subscribe_event_type::delete_setting);
+    }
+
+    TEST_CASE_CLASS ("setting ids are released with their last subscription")
+    {
+        service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
+        client client_{service_.uv_loop_->resource<uvw::PipeHandle>()};
+        auto first_id = client_.insert_db_id(config_id_st{42});
+        auto second_id = client_.insert_db_id(config_id_st{42});
+        client_.subscribe(first_id, service_.settings_ids_.intern("shared"));
+        client_.subscribe(second_id, service_.settings_ids_.intern("shared"));
+        client_.subscribe(second_id, service_.settings_ids_.intern("own"));
+        CHECK_EQ(service_.settings_ids_.size(), 2u);
+        for (auto setting_id : client_.remove_temp_id(first_id))
+            service_.settings_ids_.release(setting_id_st{setting_id});
+        CHECK_EQ(service_.settings_ids_.size(), 2u);
+        service_.release_subscriptions(client_);
+        CHECK_EQ(service_.settings_ids_.size(), 0u);
+        std::filesystem::remove(std::filesystem::current_path() / "albinos_service_test_internal.db");
+    }
+
     TEST_CASE_CLASS ("test create socket")
     {
         service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
-        if (std::filesystem::exists(service_.socket_path_)) {
-            std::filesystem::remove(service_.socket_path_);
+        if (std::filesystem::exists(service_.socket_path())) {
+            std::filesystem::remove(service_.socket_path());
         }
         CHECK_FALSE(service_.create_socket());
         CHECK(service_.create_socket());
@@ -568,7 +1381,7 @@ namespace raven
                 sock.close();
             });
 
-        client->connect(service_.socket_path_.string());
+        client->connect(service_.socket_path().string());
     }
 
     static void test_run_and_clean_client(service &service_, std::shared_ptr<uvw::Loop> &loop) noexcept
@@ -596,6 +1409,20 @@ namespace raven
         test_client_server_communication(std::move(data), std::move(answer));
     }
 
+    TEST_CASE_CLASS ("request id is echoed in the answer")
+    {
+        SUBCASE("unknown request") {
+            auto data = R"({"REQUEST_NAME": "HELLOBRUH", "REQUEST_ID": 42})"_json;
+            auto answer = R"({"REQUEST_STATE":"UNKNOWN_REQUEST", "REQUEST_ID": 42})"_json;
+            test_client_server_communication(std::move(data), std::move(answer));
+        }
+        SUBCASE("unload config") {
+            auto data = R"({"REQUEST_NAME": "CONFIG_UNLOAD", "CONFIG_ID": 42, "REQUEST_ID": 7})"_json;
+            auto answer = R"({"REQUEST_STATE":"SUCCESS", "REQUEST_ID": 7})"_json;
+            test_client_server_communication(std::move(data), std::move(answer));
+        }
+    }
+
     TEST_CASE_CLASS ("create_config request")
     {
         auto data = R"({"REQUEST_NAME": "CONFIG_CREATE","CONFIG_NAME": "ma_config"})"_json;
@@ -704,19 +1531,364 @@ namespace raven
                 sock.close();
             });
 
-        client->connect(service_.socket_path_.string());
+        client->connect(service_.socket_path().string());
+    }
+
+    TEST_CASE_CLASS ("update_setting request")
+    {
+        SUBCASE("update_setting with unknown id") {
+            auto data = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar","titi": 1}})"_json;
+            auto answer = R"({"REQUEST_STATE":"UNKNOWN_ID"})"_json;
+            test_client_server_communication(std::move(data), std::move(answer), true);
+        }
+
+        SUBCASE("update_setting with invalid value") {
+            auto data = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar","titi": ["not", "a", "value"]}})"_json;
+            auto answer = R"({"REQUEST_STATE":"BAD_ORDER"})"_json;
+            test_client_server_communication(std::move(data), std::move(answer), true);
+        }
+
+        SUBCASE ("update_setting with valid id") {
+            using namespace std::string_literals;
+            service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
+            auto answer_create = service_.db_.config_create("ma_config");
+            auto request_load = R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY" : 42})"_json;
+            request_load["CONFIG_KEY"] = answer_create.config_key.value();
+            auto expected_answer = R"({"REQUEST_STATE":"SUCCESS"})"_json;
+            CHECK_FALSE(service_.create_socket());
+            auto loop = uvw::Loop::getDefault();
+            auto client = loop->resource<uvw::PipeHandle>();
+
+            client->once<uvw::ConnectEvent>([&request_load](const uvw::ConnectEvent &, uvw::PipeHandle &handle) {
+                    CHECK(handle.writable());
+                    CHECK(handle.readable());
+                auto request_str = request_load.dump();
+                handle.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                handle.read();
+            });
+
+            client->on<uvw::DataEvent>(
+                [&expected_answer, &service_](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
+                    static int step = 0;
+                    static size_t id = 0;
+                    std::string_view data_str(data.data.get(), data.length);
+                    auto json_data = json::json::parse(data_str);
+                    auto json_data_str = json_data.dump();
+                    switch (step)
+                    {
+                        case 0:// load config
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar"}})"_json;
+                            id = json_data.at("CONFIG_ID").get<std::size_t>();
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            //expected answer unchanged.
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 1: // update setting
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto config_json_data = service_.db_.get_config(config_id_st{id});
+                            auto setting = config_json_data["SETTINGS"].find("foo");
+                            CHECK_NE(setting, config_json_data["SETTINGS"].end());
+                            CHECK_EQ(setting.value(), "bar");
+                            sock.close();
+                            break;
+                    }
+                    step += 1;
+                });
+
+            client->connect(service_.socket_path().string());
+            test_run_and_clean_client(service_, loop);
+        };
+
+        SUBCASE ("update_setting with valid id and multiple settings") {
+            using namespace std::string_literals;
+            service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
+            auto answer_create = service_.db_.config_create("ma_config");
+            auto request_load = R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY" : 42})"_json;
+            request_load["CONFIG_KEY"] = answer_create.config_key.value();
+            auto expected_answer = R"({"REQUEST_STATE":"SUCCESS"})"_json;
+            CHECK_FALSE(service_.create_socket());
+            auto loop = uvw::Loop::getDefault();
+            auto client = loop->resource<uvw::PipeHandle>();
+
+            client->once<uvw::ConnectEvent>([&request_load](const uvw::ConnectEvent &, uvw::PipeHandle &handle) {
+                    CHECK(handle.writable());
+                    CHECK(handle.readable());
+                auto request_str = request_load.dump();
+                handle.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                handle.read();
+            });
+
+            client->on<uvw::DataEvent>(
+                [&expected_answer, &service_](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
+                    static int step = 0;
+                    static size_t id = 0;
+                    std::string_view data_str(data.data.get(), data.length);
+                    auto json_data = json::json::parse(data_str);
+                    auto json_data_str = json_data.dump();
+                    switch (step)
+                    {
+                        case 0:// load config
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar","titi": "1"}})"_json;
+                            id = json_data.at("CONFIG_ID").get<std::uint32_t>();
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            //expected answer unchanged.
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 1: // update setting
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto config_json_data = service_.db_.get_config(config_id_st{id});
+                            auto setting = config_json_data["SETTINGS"].find("foo");
+                            CHECK_NE(setting, config_json_data["SETTINGS"].end());
+                            CHECK_EQ(setting.value(), "bar");
+                            setting = config_json_data["SETTINGS"].find("titi");
+                            CHECK_NE(setting, config_json_data["SETTINGS"].end());
+                            CHECK_EQ(setting.value(), "1");
+                            sock.close();
+                            break;
+                    }
+                    step += 1;
+                });
+
+            client->connect(service_.socket_path().string());
+            test_run_and_clean_client(service_, loop);
+        };
+    }
+
+    TEST_CASE_CLASS ("remove_setting request")
+    {
+        SUBCASE("remove_setting with unknown id") {
+            auto data = R"({"REQUEST_NAME": "SETTING_REMOVE","CONFIG_ID": 43,"SETTING_NAME": "foobar"})"_json;
+            auto answer = R"({"REQUEST_STATE":"UNKNOWN_ID"})"_json;
+            test_client_server_communication(std::move(data), std::move(answer));
+        }
+
+        SUBCASE("remove_setting with valid request") {
+            service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
+            auto answer_create = service_.db_.config_create("ma_config");
+            auto request_load = R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY" : 42})"_json;
+            request_load["CONFIG_KEY"] = answer_create.config_key.value();
+            auto expected_answer = R"({"REQUEST_STATE":"SUCCESS"})"_json;
+            CHECK_FALSE(service_.create_socket());
+            auto loop = uvw::Loop::getDefault();
+            auto client = loop->resource<uvw::PipeHandle>();
+
+            client->once<uvw::ConnectEvent>([&request_load](const uvw::ConnectEvent &, uvw::PipeHandle &handle) {
+                CHECK(handle.writable());
+                CHECK(handle.readable());
+                auto request_str = request_load.dump();
+                handle.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                handle.read();
+            });
+
+            client->on<uvw::DataEvent>(
+                [&expected_answer, &service_](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
+                    static int step = 0;
+                    static std::size_t id = 0;
+                    std::string_view data_str(data.data.get(), data.length);
+                    auto json_data = json::json::parse(data_str);
+                    switch (step)
+                    {
+                        case 0:// load config
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar","titi": "1"}})"_json;
+                            id = json_data.at("CONFIG_ID").get<std::size_t>();
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 1:// update setting
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTING_REMOVE","CONFIG_ID": 42,"SETTING_NAME": "titi"})"_json;
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            expected_answer["REQUEST_STATE"] = "SUCCESS";
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 2: // remove setting
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto config_json_data = service_.db_.get_config(config_id_st{id});
+                            CHECK_EQ(config_json_data["SETTINGS"].count("titi"), 0u);
+                            CHECK_EQ(config_json_data["SETTINGS"].count("foo"), 1u);
+                            sock.close();
+                            break;
+                        }
+                    }
+                    step += 1;
+                });
+
+            client->connect(service_.socket_path().string());
+            test_run_and_clean_client(service_, loop);
+        }
+
+        SUBCASE("remove_setting through update_setting") {
+            service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
+            auto answer_create = service_.db_.config_create("ma_config");
+            auto request_load = R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY" : 42})"_json;
+            request_load["CONFIG_KEY"] = answer_create.config_key.value();
+            auto expected_answer = R"({"REQUEST_STATE":"SUCCESS"})"_json;
+            CHECK_FALSE(service_.create_socket());
+            auto loop = uvw::Loop::getDefault();
+            auto client = loop->resource<uvw::PipeHandle>();
+
+            client->once<uvw::ConnectEvent>([&request_load](const uvw::ConnectEvent &, uvw::PipeHandle &handle) {
+                CHECK(handle.writable());
+                CHECK(handle.readable());
+                auto request_str = request_load.dump();
+                handle.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                handle.read();
+            });
+
+            client->on<uvw::DataEvent>(
+                [&expected_answer, &service_](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
+                    static int step = 0;
+                    static std::size_t id = 0;
+                    std::string_view data_str(data.data.get(), data.length);
+                    auto json_data = json::json::parse(data_str);
+                    switch (step)
+                    {
+                        case 0:// load config
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar","titi": "1"}})"_json;
+                            id = json_data.at("CONFIG_ID").get<std::size_t>();
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 1:// update settings
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "baz"},"SETTINGS_TO_REMOVE": ["titi", "unknown"]})"_json;
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            expected_answer["REQUEST_STATE"] = "SUCCESS";
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 2: // update and remove settings
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto config_json_data = service_.db_.get_config(config_id_st{id});
+                            CHECK_EQ(config_json_data["SETTINGS"].count("titi"), 0u);
+                            CHECK_EQ(config_json_data["SETTINGS"]["foo"], "baz");
+                            sock.close();
+                            break;
+                        }
+                    }
+                    step += 1;
+                });
+
+            client->connect(service_.socket_path().string());
+            test_run_and_clean_client(service_, loop);
+        }
+
+        SUBCASE("remove_setting with unknown setting") {
+            service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
+            auto answer_create = service_.db_.config_create("ma_config");
+            auto request_load = R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY" : 42})"_json;
+            request_load["CONFIG_KEY"] = answer_create.config_key.value();
+            auto expected_answer = R"({"REQUEST_STATE":"SUCCESS"})"_json;
+            CHECK_FALSE(service_.create_socket());
+            auto loop = uvw::Loop::getDefault();
+            auto client = loop->resource<uvw::PipeHandle>();
+
+            client->once<uvw::ConnectEvent>([&request_load](const uvw::ConnectEvent &, uvw::PipeHandle &handle) {
+                CHECK(handle.writable());
+                CHECK(handle.readable());
+                auto request_str = request_load.dump();
+                handle.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                handle.read();
+            });
+
+            client->on<uvw::DataEvent>(
+                [&expected_answer, &service_](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
+                    static int step = 0;
+                    static std::size_t id = 0;
+                    std::string_view data_str(data.data.get(), data.length);
+                    auto json_data = json::json::parse(data_str);
+                    switch (step)
+                    {
+                        case 0:// load config
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar","titi": "1"}})"_json;
+                            id = json_data.at("CONFIG_ID").get<std::size_t>();
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 1:// update setting
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTING_REMOVE","CONFIG_ID": 42,"SETTING_NAME": "lala"})"_json;
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            expected_answer["REQUEST_STATE"] = "UNKNOWN_SETTING";
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 2: // remove setting
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto config_json_data = service_.db_.get_config(config_id_st{id});
+                            CHECK_EQ(config_json_data["SETTINGS"].size(), 2u);
+                            sock.close();
+                            break;
+                        }
+                    }
+                    step += 1;
+                });
+
+            client->connect(service_.socket_path().string());
+            test_run_and_clean_client(service_, loop);
+        }
     }
 
-    TEST_CASE_CLASS ("update_setting request")
+    TEST_CASE_CLASS ("remove_settings request")
     {
-        SUBCASE("update_setting with unknown id") {
-            auto data = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar","titi": 1}})"_json;
+        SUBCASE("remove_settings with unknown id") {
+            auto data = R"({"REQUEST_NAME": "SETTINGS_REMOVE","CONFIG_ID": 43,"SETTINGS_NAMES": ["foo", "bar"]})"_json;
             auto answer = R"({"REQUEST_STATE":"UNKNOWN_ID"})"_json;
-            test_client_server_communication(std::move(data), std::move(answer), true);
+            test_client_server_communication(std::move(data), std::move(answer));
         }
 
-        SUBCASE ("update_setting with valid id") {
-            using namespace std::string_literals;
+        SUBCASE("remove_settings with valid request") {
             service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
             auto answer_create = service_.db_.config_create("ma_config");
             auto request_load = R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY" : 42})"_json;
@@ -727,8 +1899,8 @@ namespace raven
             auto client = loop->resource<uvw::PipeHandle>();
 
             client->once<uvw::ConnectEvent>([&request_load](const uvw::ConnectEvent &, uvw::PipeHandle &handle) {
-                    CHECK(handle.writable());
-                    CHECK(handle.readable());
+                CHECK(handle.writable());
+                CHECK(handle.readable());
                 auto request_str = request_load.dump();
                 handle.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
                 handle.read();
@@ -737,44 +1909,53 @@ namespace raven
             client->on<uvw::DataEvent>(
                 [&expected_answer, &service_](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
                     static int step = 0;
-                    static size_t id = 0;
+                    static std::size_t id = 0;
                     std::string_view data_str(data.data.get(), data.length);
                     auto json_data = json::json::parse(data_str);
-                    auto json_data_str = json_data.dump();
                     switch (step)
                     {
                         case 0:// load config
                         {
                             CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
                                   expected_answer.at("REQUEST_STATE").get<std::string>());
-                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar"}})"_json;
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar","titi": "1"}})"_json;
                             id = json_data.at("CONFIG_ID").get<std::size_t>();
                             request["CONFIG_ID"] = id;
                             auto request_str = request.dump();
-                            //expected answer unchanged.
                             sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
                             sock.read();
                             break;
                         }
-                        case 1: // update setting
+                        case 1:// update setting
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTINGS_REMOVE","CONFIG_ID": 42,"SETTINGS_NAMES": ["foo", "titi"]})"_json;
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            expected_answer["REQUEST_STATE"] = "SUCCESS";
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 2: // remove setting
+                        {
                             CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
                                   expected_answer.at("REQUEST_STATE").get<std::string>());
                             auto config_json_data = service_.db_.get_config(config_id_st{id});
-                            auto setting = config_json_data["SETTINGS"].find("foo");
-                            CHECK_NE(setting, config_json_data["SETTINGS"].end());
-                            CHECK_EQ(setting.value(), "bar");
+                            CHECK(config_json_data["SETTINGS"].empty());
                             sock.close();
                             break;
+                        }
                     }
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
-        };
+        }
 
-        SUBCASE ("update_setting with valid id and multiple settings") {
-            using namespace std::string_literals;
+        SUBCASE("remove_settings with one unknown setting") {
             service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
             auto answer_create = service_.db_.config_create("ma_config");
             auto request_load = R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY" : 42})"_json;
@@ -785,8 +1966,8 @@ namespace raven
             auto client = loop->resource<uvw::PipeHandle>();
 
             client->once<uvw::ConnectEvent>([&request_load](const uvw::ConnectEvent &, uvw::PipeHandle &handle) {
-                    CHECK(handle.writable());
-                    CHECK(handle.readable());
+                CHECK(handle.writable());
+                CHECK(handle.readable());
                 auto request_str = request_load.dump();
                 handle.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
                 handle.read();
@@ -795,10 +1976,9 @@ namespace raven
             client->on<uvw::DataEvent>(
                 [&expected_answer, &service_](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
                     static int step = 0;
-                    static size_t id = 0;
+                    static std::size_t id = 0;
                     std::string_view data_str(data.data.get(), data.length);
                     auto json_data = json::json::parse(data_str);
-                    auto json_data_str = json_data.dump();
                     switch (step)
                     {
                         case 0:// load config
@@ -806,40 +1986,42 @@ namespace raven
                             CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
                                   expected_answer.at("REQUEST_STATE").get<std::string>());
                             auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"foo": "bar","titi": "1"}})"_json;
-                            id = json_data.at("CONFIG_ID").get<std::uint32_t>();
+                            id = json_data.at("CONFIG_ID").get<std::size_t>();
                             request["CONFIG_ID"] = id;
                             auto request_str = request.dump();
-                            //expected answer unchanged.
                             sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
                             sock.read();
                             break;
                         }
-                        case 1: // update setting
+                        case 1:// update setting
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTINGS_REMOVE","CONFIG_ID": 42,"SETTINGS_NAMES": ["foo", "lala"]})"_json;
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            expected_answer["REQUEST_STATE"] = "UNKNOWN_SETTING";
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 2: // remove setting
+                        {
                             CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
                                   expected_answer.at("REQUEST_STATE").get<std::string>());
                             auto config_json_data = service_.db_.get_config(config_id_st{id});
-                            auto setting = config_json_data["SETTINGS"].find("foo");
-                            CHECK_NE(setting, config_json_data["SETTINGS"].end());
-                            CHECK_EQ(setting.value(), "bar");
-                            setting = config_json_data["SETTINGS"].find("titi");
-                            CHECK_NE(setting, config_json_data["SETTINGS"].end());
-                            CHECK_EQ(setting.value(), "1");
+                            CHECK_EQ(config_json_data["SETTINGS"].count("foo"), 1u);
+                            CHECK_EQ(config_json_data["SETTINGS"].count("titi"), 1u);
                             sock.close();
                             break;
+                        }
                     }
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
-        };
-    }
-
-    TEST_CASE_CLASS ("remove_setting request")
-    {
-        auto data = R"({"REQUEST_NAME": "SETTING_REMOVE","CONFIG_ID": 43,"SETTING_NAME": "foobar"})"_json;
-        auto answer = R"({"REQUEST_STATE":"SUCCESS"})"_json;
-        test_client_server_communication(std::move(data), std::move(answer));
+        }
     }
 
     TEST_CASE_CLASS ("get_setting request")
@@ -899,7 +2081,7 @@ namespace raven
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
         }
 
@@ -963,7 +2145,142 @@ namespace raven
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
+            test_run_and_clean_client(service_, loop);
+        }
+
+        SUBCASE("get_setting keeps the type of the value") {
+            service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
+            auto answer_create = service_.db_.config_create("ma_config");
+            auto request_load = R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY" : 42})"_json;
+            request_load["CONFIG_KEY"] = answer_create.config_key.value();
+            auto expected_answer = R"({"REQUEST_STATE":"SUCCESS"})"_json;
+                CHECK_FALSE(service_.create_socket());
+            auto loop = uvw::Loop::getDefault();
+            auto client = loop->resource<uvw::PipeHandle>();
+
+            client->once<uvw::ConnectEvent>([&request_load](const uvw::ConnectEvent &, uvw::PipeHandle &handle) {
+                    CHECK(handle.writable());
+                    CHECK(handle.readable());
+                auto request_str = request_load.dump();
+                handle.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                handle.read();
+            });
+
+            client->on<uvw::DataEvent>(
+                [&expected_answer](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
+                    static int step = 0;
+                    static uint32_t id = 0;
+                    std::string_view data_str(data.data.get(), data.length);
+                    auto json_data = json::json::parse(data_str);
+                    auto json_data_str = json_data.dump();
+                    switch (step)
+                    {
+                        case 0:// load config
+                        {
+                                CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                      expected_answer.at("REQUEST_STATE").get<std::string>());
+                            id = json_data.at("CONFIG_ID").get<std::uint32_t>();
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"titi": 1, "on": true, "raw": {"BLOB": "AAEC"}}})"_json;
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            // unchanged expected answer
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 1:// update config
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTING_GET","CONFIG_ID": 42,"SETTING_NAME": "raw"})"_json;
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 2: // get setting
+                            expected_answer = R"({"SETTING_VALUE" : {"BLOB": "AAEC"}, "REQUEST_STATE" : "SUCCESS"})"_json;
+                            CHECK(json_data == expected_answer);
+                            sock.close();
+                            break;
+                    }
+                    step += 1;
+                });
+
+            client->connect(service_.socket_path().string());
+            test_run_and_clean_client(service_, loop);
+        }
+    }
+
+    TEST_CASE_CLASS ("get_settings request")
+    {
+        SUBCASE("get_settings with unknown id") {
+            auto data = R"({"REQUEST_NAME": "SETTINGS_GET","CONFIG_ID": 42, "SETTINGS_NAMES": ["titi"]})"_json;
+            auto answer = R"({"REQUEST_STATE":"UNKNOWN_ID"})"_json;
+            test_client_server_communication(std::move(data), std::move(answer), true);
+        }
+
+        SUBCASE("get_settings with an unknown setting") {
+            service service_{std::filesystem::current_path() / "albinos_service_test_internal.db"};
+            auto answer_create = service_.db_.config_create("ma_config");
+            auto request_load = R"({"REQUEST_NAME": "CONFIG_LOAD", "CONFIG_KEY" : 42})"_json;
+            request_load["CONFIG_KEY"] = answer_create.config_key.value();
+            auto expected_answer = R"({"REQUEST_STATE":"SUCCESS"})"_json;
+                CHECK_FALSE(service_.create_socket());
+            auto loop = uvw::Loop::getDefault();
+            auto client = loop->resource<uvw::PipeHandle>();
+
+            client->once<uvw::ConnectEvent>([&request_load](const uvw::ConnectEvent &, uvw::PipeHandle &handle) {
+                    CHECK(handle.writable());
+                    CHECK(handle.readable());
+                auto request_str = request_load.dump();
+                handle.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                handle.read();
+            });
+
+            client->on<uvw::DataEvent>(
+                [&expected_answer](const uvw::DataEvent &data, uvw::PipeHandle &sock) {
+                    static int step = 0;
+                    static uint32_t id = 0;
+                    std::string_view data_str(data.data.get(), data.length);
+                    auto json_data = json::json::parse(data_str);
+                    switch (step)
+                    {
+                        case 0:// load config
+                        {
+                                CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                      expected_answer.at("REQUEST_STATE").get<std::string>());
+                            id = json_data.at("CONFIG_ID").get<std::uint32_t>();
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"titi": "1", "lala": "lala", "toto": "2"}})"_json;
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 1:// update config
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SETTINGS_GET","CONFIG_ID": 42, "SETTINGS_NAMES": ["titi", "unknown", "lala"]})"_json;
+                            request["CONFIG_ID"] = id;
+                            auto request_str = request.dump();
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 2: // get settings
+                            expected_answer = R"({"SETTINGS" : {"titi": "1", "lala": "lala"}, "REQUEST_STATE" : "SUCCESS"})"_json;
+                            CHECK(json_data == expected_answer);
+                            sock.close();
+                            break;
+                    }
+                    step += 1;
+                });
+
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
         }
     }
@@ -1036,7 +2353,7 @@ namespace raven
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
         }
 
@@ -1100,7 +2417,7 @@ namespace raven
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
         }
     }
@@ -1173,7 +2490,7 @@ namespace raven
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
         }
 
@@ -1237,7 +2554,7 @@ namespace raven
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
         }
     }
@@ -1329,7 +2646,7 @@ namespace raven
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
         }
 
@@ -1378,7 +2695,7 @@ namespace raven
                         {
                             CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
                                   expected_answer.at("REQUEST_STATE").get<std::string>());
-                            auto request = R"({"REQUEST_NAME": "SUBSCRIBE_SETTING","CONFIG_ID": 42,"SETTING_NAME": "titi"})"_json;
+                            auto request = R"({"REQUEST_NAME": "SETTING_UPDATE","CONFIG_ID": 42,"SETTINGS_TO_UPDATE": {"titi": "1"}})"_json;
                             config_id = json_data.at("CONFIG_ID").get<std::uint32_t>();
                             request["CONFIG_ID"] = config_id;
                             auto request_str = request.dump();
@@ -1387,7 +2704,19 @@ namespace raven
                             sock.read();
                             break;
                         }
-                        case 1: // subscribe setting
+                        case 1: // update setting
+                        {
+                            CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
+                                  expected_answer.at("REQUEST_STATE").get<std::string>());
+                            auto request = R"({"REQUEST_NAME": "SUBSCRIBE_SETTING","CONFIG_ID": 42,"SETTING_NAME": "titi"})"_json;
+                            request["CONFIG_ID"] = config_id;
+                            auto request_str = request.dump();
+                            //expected answer unchanged.
+                            sock.write(request_str.data(), static_cast<unsigned int>(request_str.size()));
+                            sock.read();
+                            break;
+                        }
+                        case 2: // subscribe setting
                         {
                                 CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
                                       expected_answer.at("REQUEST_STATE").get<std::string>());
@@ -1399,7 +2728,7 @@ namespace raven
                             sock.read();
                             break;
                         }
-                        case 2: // delete setting and response from the subscribe event
+                        case 3: // delete setting and response from the subscribe event
                             CHECK(json_data.at("REQUEST_STATE").get<std::string>() ==
                                   expected_answer.at("REQUEST_STATE").get<std::string>());
                             auto expected = R"({"CONFIG_ID": 42, "SETTING_NAME": "titi", "SUBSCRIPTION_EVENT_TYPE" : "DELETE"})"_json;
@@ -1413,7 +2742,7 @@ namespace raven
                     step += 1;
                 });
 
-            client->connect(service_.socket_path_.string());
+            client->connect(service_.socket_path().string());
             test_run_and_clean_client(service_, loop);
         }
 
@@ -5,11 +5,13 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include "st/st.hpp"
 
 namespace raven
 {
   using config_id_st = st::type<std::size_t, struct config_id_tag, st::arithmetic>;
+  using setting_id_st = st::type<std::uint32_t, struct setting_id_tag>;
   using config_key_st = st::type<std::string, struct config_key_tag,
       st::equality_comparable,
       st::addable_with<const char *>,
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <vector>
+#include <unordered_map>
+#include "service_strong_types.hpp"
+
+namespace raven
+{
+  class settings_interner
+  {
+  public:
+    setting_id_st intern(const std::string &setting_name)
+    {
+        /*
+         * Return the id associated to the setting name, a new one is created if the name is not interned yet
+         *
+         * Each call takes a reference on the id, which must be given back with release() once the
+         * subscription using it goes away
+         *
+         */
+
+        auto it = ids_.find(setting_name);
+        if (it == ids_.end()) {
+            setting_id_st::value_type id;
+            if (free_ids_.empty()) {
+                id = static_cast<setting_id_st::value_type>(names_.size());
+                names_.emplace_back();
+            } else {
+                id = free_ids_.back();
+                free_ids_.pop_back();
+            }
+            it = ids_.emplace(setting_name, entry{id, 0}).first;
+            names_[id] = &it->first;
+        }
+        it->second.nb_references++;
+        return setting_id_st{it->second.id};
+    }
+
+    void release(setting_id_st setting_id)
+    {
+        /*
+         * Give back a reference taken by intern(), the name is forgotten and its id reused once nobody uses it
+         */
+
+        auto it = ids_.find(*names_.at(setting_id.value()));
+        if (--it->second.nb_references)
+            return;
+        names_[setting_id.value()] = nullptr;
+        free_ids_.push_back(setting_id.value());
+        ids_.erase(it);
+    }
+
+    std::optional<setting_id_st> find(const std::string &setting_name) const noexcept
+    {
+        /*
+         * Return the id associated to the setting name, or std::nullopt if nobody is subscribed to it
+         */
+
+        auto it = ids_.find(setting_name);
+        if (it == ids_.end())
+            return std::nullopt;
+        return setting_id_st{it->second.id};
+    }
+
+    std::size_t size() const noexcept
+    {
+        return ids_.size();
+    }
+
+  private:
+    struct entry
+    {
+      setting_id_st::value_type id;
+      std::size_t nb_references;
+    };
+
+    std::unordered_map<std::string, entry> ids_;
+    std::vector<const std::string *> names_; // by id, the keys of ids_ are not moved by a rehash
+    std::vector<setting_id_st::value_type> free_ids_;
+  };
+}
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+TEST_CASE ("settings interner")
+{
+    raven::settings_interner interner;
+    SUBCASE("same name same id") {
+        auto id = interner.intern("foo");
+        CHECK_EQ(interner.intern("foo").value(), id.value());
+        CHECK_NE(interner.intern("bar").value(), id.value());
+        CHECK_EQ(interner.size(), 2u);
+    }
+    SUBCASE("find unknown name") {
+        CHECK_FALSE(interner.find("foo").has_value());
+        auto id = interner.intern("foo");
+        CHECK(interner.find("foo").has_value());
+        CHECK_EQ(interner.find("foo").value().value(), id.value());
+    }
+    SUBCASE("ids are released with their last reference") {
+        auto id = interner.intern("foo");
+        interner.intern("foo");
+        interner.release(id);
+        CHECK(interner.find("foo").has_value());
+        interner.release(id);
+        CHECK_FALSE(interner.find("foo").has_value());
+        CHECK_EQ(interner.size(), 0u);
+        CHECK_EQ(interner.intern("bar").value(), id.value());
+    }
+}
+#endif
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <json.hpp>
+
+namespace raven
+{
+  using stats_clock = std::chrono::steady_clock;
+
+  class latency_histogram
+  {
+  public:
+    /*
+     * Durations in nanoseconds, in log-linear buckets like an HDR histogram
+     *
+     * Each power of two is split in 8 buckets, so a recorded value is off by less than 12.5%,
+     * and recording is a few integer operations on a fixed array
+     *
+     */
+
+    void record(std::uint64_t value) noexcept
+    {
+        ++counts_[bucket_index(value)];
+        ++count_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void record(std::chrono::nanoseconds duration) noexcept
+    {
+        record(static_cast<std::uint64_t>(duration.count() > 0 ? duration.count() : 0));
+    }
+
+    std::uint64_t count() const noexcept
+    {
+        return count_;
+    }
+
+    //! Highest value of the bucket holding the given percentile, from 0 to 100
+    std::uint64_t value_at_percentile(double percentile) const noexcept
+    {
+        if (!count_)
+            return 0;
+        auto rank = static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5);
+        rank = std::clamp<std::uint64_t>(rank, 1, count_);
+        std::uint64_t seen = 0;
+        for (std::size_t index = 0; index < nb_buckets; ++index) {
+            seen += counts_[index];
+            if (seen >= rank)
+                return std::min(bucket_highest_value(index), max_);
+        }
+        return max_;
+    }
+
+    nlohmann::json to_json() const
+    {
+        return {{"COUNT", count_},
+                {"MIN",   count_ ? min_ : 0},
+                {"MAX",   max_},
+                {"MEAN",  count_ ? sum_ / count_ : 0},
+                {"P50",   value_at_percentile(50)},
+                {"P90",   value_at_percentile(90)},
+                {"P99",   value_at_percentile(99)},
+                {"P999",  value_at_percentile(99.9)}};
+    }
+
+  private:
+    static constexpr unsigned int sub_bucket_bits = 3;
+    static constexpr std::uint64_t nb_sub_buckets = 1u << sub_bucket_bits;
+    static constexpr std::size_t nb_buckets = (64 - sub_bucket_bits + 1) * nb_sub_buckets;
+
+    static std::size_t bucket_index(std::uint64_t value) noexcept
+    {
+        if (value < nb_sub_buckets)
+            return static_cast<std::size_t>(value);
+        unsigned int shift = 63 - static_cast<unsigned int>(__builtin_clzll(value)) - sub_bucket_bits;
+        return static_cast<std::size_t>((shift + 1) * nb_sub_buckets + (value >> shift) - nb_sub_buckets);
+    }
+
+    static std::uint64_t bucket_highest_value(std::size_t index) noexcept
+    {
+        if (index < nb_sub_buckets)
+            return index;
+        auto shift = index / nb_sub_buckets - 1;
+        auto sub_bucket = index % nb_sub_buckets + nb_sub_buckets;
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+    std::array<std::uint64_t, nb_buckets> counts_{};
+    std::uint64_t count_{0};
+    std::uint64_t sum_{0};
+    std::uint64_t min_{std::numeric_limits<std::uint64_t>::max()};
+    std::uint64_t max_{0};
+  };
+
+  //! Adds the time spent in its scope to total
+  class scoped_duration
+  {
+  public:
+    explicit scoped_duration(std::chrono::nanoseconds &total) noexcept : total_{total}
+    {
+    }
+
+    ~scoped_duration() noexcept
+    {
+        total_ += stats_clock::now() - start_;
+    }
+
+    scoped_duration(const scoped_duration &) = delete;
+    scoped_duration &operator=(const scoped_duration &) = delete;
+
+  private:
+    std::chrono::nanoseconds &total_;
+    stats_clock::time_point start_{stats_clock::now()};
+  };
+
+  //! What a request spent outside of its handler, filled while it is handled
+  struct request_timings
+  {
+    std::chrono::nanoseconds parse{0};
+    std::chrono::nanoseconds db{0};
+    std::chrono::nanoseconds serialization{0};
+    //! Finding the subscribers of the changed settings and queuing their events
+    std::chrono::nanoseconds fan_out{0};
+    std::chrono::nanoseconds write{0};
+    //! REQUEST_STATE of the answer
+    std::string state;
+  };
+
+  struct command_stats
+  {
+    std::uint64_t count{0};
+    std::unordered_map<std::string, std::uint64_t> answers;
+    latency_histogram total;
+    latency_histogram parse;
+    latency_histogram db;
+    latency_histogram serialization;
+    latency_histogram fan_out;
+    latency_histogram write;
+  };
+
+  class service_stats
+  {
+  public:
+    /*
+     * Counters and latency histograms of every request, kept by the loop thread
+     *
+     * TOTAL is the time from the received message to the written answer,
+     * PARSE, DB, SERIALIZATION, FAN_OUT and WRITE are the parts of it spent in parsing the json, in config_db,
+     * in json dumps, in queuing the events of the subscribers and in socket writes
+     *
+     */
+
+    void record(const std::string &command, std::chrono::nanoseconds total, const request_timings &timings)
+    {
+        auto &stats = commands_[command];
+        ++nb_requests_;
+        ++stats.count;
+        ++stats.answers[timings.state];
+        stats.total.record(total);
+        stats.parse.record(timings.parse);
+        stats.db.record(timings.db);
+        stats.serialization.record(timings.serialization);
+        stats.fan_out.record(timings.fan_out);
+        stats.write.record(timings.write);
+    }
+
+    std::uint64_t nb_requests() const noexcept
+    {
+        return nb_requests_;
+    }
+
+    nlohmann::json snapshot() const
+    {
+        nlohmann::json commands = nlohmann::json::object();
+        for (auto &&[command, stats] : commands_) {
+            std::uint64_t nb_errors = stats.count;
+            if (auto success = stats.answers.find("SUCCESS"); success != stats.answers.end())
+                nb_errors -= success->second;
+            commands[command] = {{"COUNT",      stats.count},
+                                 {"ERRORS",     nb_errors},
+                                 {"ANSWERS",    stats.answers},
+                                 {"LATENCY_NS", {{"TOTAL",         stats.total.to_json()},
+                                                 {"PARSE",         stats.parse.to_json()},
+                                                 {"DB",            stats.db.to_json()},
+                                                 {"SERIALIZATION", stats.serialization.to_json()},
+                                                 {"FAN_OUT",       stats.fan_out.to_json()},
+                                                 {"WRITE",         stats.write.to_json()}}}};
+        }
+        auto uptime = std::chrono::duration_cast<std::chrono::milliseconds>(stats_clock::now() - start_);
+        return {{"UPTIME_MS", uptime.count()},
+                {"COMMANDS",  std::move(commands)}};
+    }
+
+  private:
+    stats_clock::time_point start_{stats_clock::now()};
+    std::uint64_t nb_requests_{0};
+    std::unordered_map<std::string, command_stats> commands_;
+  };
+
+  //! A request which took longer than the slow request threshold
+  struct slow_request
+  {
+    std::string command;
+    std::optional<std::uint64_t> config_id{std::nullopt};
+    std::size_t payload_size{0};
+    std::chrono::system_clock::time_point time;
+    std::chrono::nanoseconds total{0};
+    request_timings timings;
+
+    nlohmann::json to_json() const
+    {
+        auto us = [](std::chrono::nanoseconds duration) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        };
+        nlohmann::json slow_request_data{{"COMMAND",       command},
+                                         {"PAYLOAD_SIZE",  payload_size},
+                                         {"TIME_MS",       std::chrono::duration_cast<std::chrono::milliseconds>(
+                                             time.time_since_epoch()).count()},
+                                         {"REQUEST_STATE", timings.state},
+                                         {"LATENCY_US",    {{"TOTAL",         us(total)},
+                                                            {"PARSE",         us(timings.parse)},
+                                                            {"DB",            us(timings.db)},
+                                                            {"SERIALIZATION", us(timings.serialization)},
+                                                            {"FAN_OUT",       us(timings.fan_out)},
+                                                            {"WRITE",         us(timings.write)}}}};
+        if (config_id)
+            slow_request_data["CONFIG_ID"] = config_id.value();
+        return slow_request_data;
+    }
+  };
+
+  class slow_request_log
+  {
+  public:
+    /*
+     * The last max_entries requests slower than the threshold, oldest first
+     *
+     * Disabled while the threshold isn't set, so that a fast request only costs a comparison
+     *
+     */
+
+    static constexpr std::size_t max_entries = 128;
+
+    std::optional<std::chrono::microseconds> threshold() const noexcept
+    {
+        return threshold_;
+    }
+
+    void set_threshold(std::optional<std::chrono::microseconds> threshold) noexcept
+    {
+        threshold_ = threshold;
+    }
+
+    bool is_slow(std::chrono::nanoseconds total) const noexcept
+    {
+        return threshold_ && total >= threshold_.value();
+    }
+
+    const slow_request &record(slow_request &&request)
+    {
+        if (entries_.size() == max_entries)
+            entries_.pop_front();
+        entries_.push_back(std::move(request));
+        return entries_.back();
+    }
+
+    nlohmann::json to_json() const
+    {
+        nlohmann::json slow_requests = nlohmann::json::array();
+        for (auto &entry : entries_)
+            slow_requests.push_back(entry.to_json());
+        return slow_requests;
+    }
+
+  private:
+    std::optional<std::chrono::microseconds> threshold_{std::nullopt};
+    std::deque<slow_request> entries_;
+  };
+}
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+TEST_CASE ("latency histogram")
+{
+    raven::latency_histogram histogram;
+    SUBCASE("empty") {
+        CHECK_EQ(histogram.count(), 0u);
+        CHECK_EQ(histogram.value_at_percentile(50), 0u);
+    }
+    SUBCASE("small values are exact") {
+        for (std::uint64_t value = 1; value <= 8; ++value)
+            histogram.record(value);
+        CHECK_EQ(histogram.count(), 8u);
+        CHECK_EQ(histogram.value_at_percentile(50), 4u);
+        CHECK_EQ(histogram.value_at_percentile(100), 8u);
+    }
+    SUBCASE("large values are within 12.5%") {
+        for (std::uint64_t value = 1; value <= 1000; ++value)
+            histogram.record(value * 1000);
+        auto p50 = histogram.value_at_percentile(50);
+        auto p99 = histogram.value_at_percentile(99);
+        CHECK_GE(p50, 500000u);
+        CHECK_LE(p50, 562500u);
+        CHECK_GE(p99, 990000u);
+        CHECK_LE(p99, 1000000u);
+        CHECK_EQ(histogram.to_json().at("MAX"), 1000000u);
+    }
+}
+
+TEST_CASE ("slow request log")
+{
+    raven::slow_request_log log;
+    SUBCASE("disabled without threshold") {
+        CHECK_FALSE(log.is_slow(std::chrono::hours(1)));
+    }
+    SUBCASE("only the last entries are kept") {
+        log.set_threshold(std::chrono::microseconds(10));
+        CHECK_FALSE(log.is_slow(std::chrono::microseconds(9)));
+        CHECK(log.is_slow(std::chrono::microseconds(10)));
+        for (std::size_t i = 0; i < raven::slow_request_log::max_entries + 1; ++i)
+            log.record({"SETTING_GET", i, 42, std::chrono::system_clock::now(), std::chrono::microseconds(i), {}});
+        auto entries = log.to_json();
+        REQUIRE_EQ(entries.size(), raven::slow_request_log::max_entries);
+        CHECK_EQ(entries.front().at("CONFIG_ID"), 1);
+        CHECK_EQ(entries.front().at("LATENCY_US").at("TOTAL"), 1);
+        CHECK_EQ(entries.back().at("PAYLOAD_SIZE"), 42);
+    }
+}
+#endif
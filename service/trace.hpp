@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <json.hpp>
+
+namespace raven
+{
+  inline constexpr const char trace_id_keyword[] = "TRACE_ID";
+
+  class tracer
+  {
+  public:
+    /*
+     * Spans of the handled requests, exported as Chrome trace events
+     *
+     * Timestamps are steady_clock microseconds, the system-wide monotonic clock on linux,
+     * so the spans recorded by libalbinos in another process line up with these ones.
+     * A request tagged with a TRACE_ID by libalbinos gets a flow step with that id,
+     * which a trace viewer draws as an arrow from the client to the service.
+     *
+     * Nothing is recorded while disabled, and at most max_events are kept until taken.
+     *
+     */
+
+    using clock = std::chrono::steady_clock;
+
+    static tracer &instance() noexcept
+    {
+        static tracer instance;
+        return instance;
+    }
+
+    bool enabled() const noexcept
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    void set_enabled(bool enabled) noexcept
+    {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    void record_span(std::string name, const char *category, clock::time_point start, clock::time_point end,
+                     std::string trace_id = {})
+    {
+        push({std::move(name), category, 'X', to_us(start), to_us(end) - to_us(start), std::move(trace_id)});
+    }
+
+    void record_flow_step(const std::string &trace_id, clock::time_point time)
+    {
+        push({"request", "flow", 't', to_us(time), 0, trace_id});
+    }
+
+    //! Chrome trace events recorded since the last call
+    nlohmann::json take_events()
+    {
+        std::vector<event> events;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            events.swap(events_);
+        }
+        nlohmann::json trace_events = nlohmann::json::array();
+        for (auto &recorded : events) {
+            nlohmann::json trace_event{{"name", recorded.name},
+                                       {"cat",  recorded.category},
+                                       {"ph",   std::string(1, recorded.phase)},
+                                       {"ts",   recorded.timestamp},
+                                       {"pid",  pid_},
+                                       {"tid",  recorded.tid}};
+            if (recorded.phase == 'X')
+                trace_event["dur"] = recorded.duration;
+            if (!recorded.trace_id.empty()) {
+                if (recorded.phase == 'X')
+                    trace_event["args"] = {{trace_id_keyword, recorded.trace_id}};
+                else
+                    trace_event["id"] = recorded.trace_id;
+            }
+            trace_events.push_back(std::move(trace_event));
+        }
+        return trace_events;
+    }
+
+  private:
+    static constexpr std::size_t max_events = 1u << 20;
+
+    struct event
+    {
+      std::string name;
+      const char *category;
+      char phase;
+      std::int64_t timestamp;
+      std::int64_t duration;
+      std::string trace_id;
+      long tid{0};
+    };
+
+    tracer() = default;
+
+    static std::int64_t to_us(clock::time_point time) noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+
+    void push(event &&recorded)
+    {
+        static thread_local long tid = syscall(SYS_gettid);
+        recorded.tid = tid;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (events_.size() < max_events)
+            events_.push_back(std::move(recorded));
+    }
+
+    std::atomic<bool> enabled_{false};
+    std::mutex mutex_;
+    std::vector<event> events_;
+    const int pid_{static_cast<int>(getpid())};
+  };
+
+  //! Records its scope as a span, if tracing was enabled when it started
+  class trace_span
+  {
+  public:
+    trace_span(const char *name, const char *category) noexcept : name_{name}, category_{category}
+    {
+        if (tracer::instance().enabled())
+            start_ = tracer::clock::now();
+    }
+
+    ~trace_span() noexcept
+    {
+        if (start_ != tracer::clock::time_point{}) {
+            try {
+                tracer::instance().record_span(name_, category_, start_, tracer::clock::now());
+            }
+            catch (const std::exception &) {
+            }
+        }
+    }
+
+    trace_span(const trace_span &) = delete;
+    trace_span &operator=(const trace_span &) = delete;
+
+  private:
+    const char *name_;
+    const char *category_;
+    tracer::clock::time_point start_{};
+  };
+}
+
+#ifdef DOCTEST_LIBRARY_INCLUDED
+TEST_CASE ("tracer")
+{
+    auto &tracer = raven::tracer::instance();
+    tracer.take_events();
+    SUBCASE("nothing is recorded while disabled") {
+        {
+            raven::trace_span span{"disabled", "test"};
+        }
+        CHECK(tracer.take_events().empty());
+    }
+    SUBCASE("spans and flow steps are chrome trace events") {
+        tracer.set_enabled(true);
+        {
+            raven::trace_span span{"enabled", "test"};
+        }
+        auto now = raven::tracer::clock::now();
+        tracer.record_flow_step("1-2", now);
+        tracer.record_span("SETTING_GET", "request", now, now + std::chrono::microseconds(5), "1-2");
+        tracer.set_enabled(false);
+        auto events = tracer.take_events();
+        REQUIRE_EQ(events.size(), 3u);
+        CHECK_EQ(events[0].at("name"), "enabled");
+        CHECK_EQ(events[0].at("ph"), "X");
+        CHECK_EQ(events[1].at("ph"), "t");
+        CHECK_EQ(events[1].at("id"), "1-2");
+        CHECK_EQ(events[2].at("dur"), 5);
+        CHECK_EQ(events[2].at("args").at("TRACE_ID"), "1-2");
+        CHECK(tracer.take_events().empty());
+    }
+}
+#endif
@@ -0,0 +1,207 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include "embedded_service.hpp"
+#include "Albinos.h"
+
+namespace
+{
+  //! A service of its own, which the next connection of the lib goes to
+  class lib_service
+  {
+  public:
+    explicit lib_service(const std::string &name, const raven::client_limits &limits = {})
+    : db_path_{std::filesystem::current_path() / ("albinos_lib_test_" + name + ".db")}, service_{db_path_.path}
+    {
+        service_.set_client_limits(limits);
+        setenv("ALBINOS_SOCKET_PATH", service_.socket_path().c_str(), 1);
+    }
+
+  private:
+    struct db_file
+    {
+      std::filesystem::path path;
+
+      ~db_file()
+      {
+          std::filesystem::remove(path);
+      }
+    };
+
+    db_file db_path_;
+    raven::embedded_service service_;
+  };
+
+  using config_ptr = std::unique_ptr<Albinos::Config, void (*)(Albinos::Config const *)>;
+
+  config_ptr create_config(const char *name)
+  {
+      Albinos::Config *config = nullptr;
+      REQUIRE_EQ(Albinos::createConfig(name, &config), Albinos::SUCCESS);
+      return {config, &Albinos::releaseConfig};
+  }
+
+  //! The same config, loaded a second time by the process
+  config_ptr load_again(Albinos::Config *config)
+  {
+      Albinos::Key key{};
+      REQUIRE_EQ(Albinos::getConfigKey(config, &key), Albinos::SUCCESS);
+      Albinos::Config *loaded = nullptr;
+      auto result = Albinos::getConfig(key, &loaded);
+      delete[] key.data;
+      REQUIRE_EQ(result, Albinos::SUCCESS);
+      return {loaded, &Albinos::releaseConfig};
+  }
+
+  std::string read_setting(Albinos::Config *config, const char *name)
+  {
+      std::size_t size = 0;
+      REQUIRE_EQ(Albinos::getSettingSize(config, name, &size), Albinos::SUCCESS);
+      std::string value(size, '\0');
+      REQUIRE_EQ(Albinos::getSettingValue(config, name, value.data(), value.size()), Albinos::SUCCESS);
+      return value;
+  }
+
+  //! A round trip to the service, which hands every event it sent before to the lib
+  void sync_events(Albinos::Config *config)
+  {
+      std::size_t size = 0;
+      Albinos::getSettingSize(config, "sync_events", &size);
+  }
+}
+
+TEST_CASE ("settings cache")
+{
+    SUBCASE("a cached value is dropped once another config changes it") {
+        lib_service service{"cache_invalidation"};
+        auto config = create_config("cache");
+        REQUIRE_EQ(Albinos::setSetting(config.get(), "cached", "first"), Albinos::SUCCESS);
+        CHECK_EQ(read_setting(config.get(), "cached"), "first");
+        CHECK_EQ(read_setting(config.get(), "cached"), "first");
+        auto other = load_again(config.get());
+        REQUIRE_EQ(Albinos::setSetting(other.get(), "cached", "second"), Albinos::SUCCESS);
+        sync_events(config.get());
+        CHECK_EQ(read_setting(config.get(), "cached"), "second");
+    }
+    SUBCASE("a local write drops the cached value") {
+        lib_service service{"cache_local_write"};
+        auto config = create_config("cache");
+        REQUIRE_EQ(Albinos::setSettingInt(config.get(), "counter", 1), Albinos::SUCCESS);
+        int64_t value = 0;
+        REQUIRE_EQ(Albinos::getSettingInt(config.get(), "counter", &value), Albinos::SUCCESS);
+        CHECK_EQ(value, 1);
+        REQUIRE_EQ(Albinos::setSettingInt(config.get(), "counter", 2), Albinos::SUCCESS);
+        REQUIRE_EQ(Albinos::getSettingInt(config.get(), "counter", &value), Albinos::SUCCESS);
+        CHECK_EQ(value, 2);
+        REQUIRE_EQ(Albinos::removeSetting(config.get(), "counter"), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::getSettingInt(config.get(), "counter", &value), Albinos::UNKNOWN_SETTING);
+    }
+    SUBCASE("a value whose subscription is refused is not cached") {
+        raven::client_limits limits;
+        limits.max_subscriptions = 1;
+        lib_service service{"cache_refused", limits};
+        auto config = create_config("cache");
+        REQUIRE_EQ(Albinos::setSetting(config.get(), "watched", "first"), Albinos::SUCCESS);
+        REQUIRE_EQ(Albinos::setSetting(config.get(), "unwatched", "first"), Albinos::SUCCESS);
+        CHECK_EQ(read_setting(config.get(), "watched"), "first");
+        CHECK_EQ(read_setting(config.get(), "unwatched"), "first");
+        auto other = load_again(config.get());
+        REQUIRE_EQ(Albinos::setSetting(other.get(), "unwatched", "second"), Albinos::SUCCESS);
+        CHECK_EQ(read_setting(config.get(), "unwatched"), "second");
+    }
+    SUBCASE("a disabled cache reads every value from the service") {
+        lib_service service{"cache_disabled"};
+        auto config = create_config("cache");
+        REQUIRE_EQ(Albinos::setSetting(config.get(), "setting", "first"), Albinos::SUCCESS);
+        CHECK_EQ(read_setting(config.get(), "setting"), "first");
+        REQUIRE_EQ(Albinos::setSettingsCacheEnabled(config.get(), 0), Albinos::SUCCESS);
+        auto other = load_again(config.get());
+        REQUIRE_EQ(Albinos::setSetting(other.get(), "setting", "second"), Albinos::SUCCESS);
+        CHECK_EQ(read_setting(config.get(), "setting"), "second");
+    }
+}
+
+TEST_CASE ("typed setters")
+{
+    raven::client_limits limits;
+    limits.max_requests_per_second = 4;
+    lib_service service{"setters", limits};
+    auto config = create_config("setters");
+    SUBCASE("the state of the update is returned") {
+        // creating the config took two requests out of the four allowed
+        CHECK_EQ(Albinos::setSettingBool(config.get(), "flag", 1), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::setSettingInt(config.get(), "number", 42), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::setSettingDouble(config.get(), "ratio", 0.5), Albinos::LIMIT_EXCEEDED);
+    }
+}
+
+TEST_CASE ("removed settings")
+{
+    lib_service service{"remove"};
+    auto config = create_config("remove");
+    REQUIRE_EQ(Albinos::setSettingInt(config.get(), "first", 1), Albinos::SUCCESS);
+    REQUIRE_EQ(Albinos::setSettingInt(config.get(), "second", 2), Albinos::SUCCESS);
+    int64_t value = 0;
+    SUBCASE("a missing setting is reported") {
+        CHECK_EQ(Albinos::removeSetting(config.get(), "missing"), Albinos::UNKNOWN_SETTING);
+        CHECK_EQ(Albinos::removeSetting(config.get(), "first"), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::getSettingInt(config.get(), "first", &value), Albinos::UNKNOWN_SETTING);
+    }
+    SUBCASE("nothing is removed if one of the settings is missing") {
+        char const *names[] = {"first", "missing", "second"};
+        CHECK_EQ(Albinos::removeSettings(config.get(), names, 3), Albinos::UNKNOWN_SETTING);
+        CHECK_EQ(Albinos::getSettingInt(config.get(), "first", &value), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::getSettingInt(config.get(), "second", &value), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::removeSettings(config.get(), names, 1), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::getSettingInt(config.get(), "first", &value), Albinos::UNKNOWN_SETTING);
+    }
+}
+
+TEST_CASE ("batched updates")
+{
+    lib_service service{"batch"};
+    auto config = create_config("batch");
+    REQUIRE_EQ(Albinos::setSettingInt(config.get(), "removed", 0), Albinos::SUCCESS);
+    SUBCASE("changes are sent by commitUpdate") {
+        REQUIRE_EQ(Albinos::beginUpdate(config.get()), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::beginUpdate(config.get()), Albinos::UPDATE_IN_PROGRESS);
+        REQUIRE_EQ(Albinos::setSettingInt(config.get(), "first", 1), Albinos::SUCCESS);
+        REQUIRE_EQ(Albinos::setSettingInt(config.get(), "second", 2), Albinos::SUCCESS);
+        REQUIRE_EQ(Albinos::removeSetting(config.get(), "removed"), Albinos::SUCCESS);
+        auto other = load_again(config.get());
+        int64_t value = 0;
+        CHECK_EQ(Albinos::getSettingInt(other.get(), "first", &value), Albinos::UNKNOWN_SETTING);
+        REQUIRE_EQ(Albinos::commitUpdate(config.get()), Albinos::SUCCESS);
+        REQUIRE_EQ(Albinos::getSettingInt(other.get(), "first", &value), Albinos::SUCCESS);
+        CHECK_EQ(value, 1);
+        REQUIRE_EQ(Albinos::getSettingInt(config.get(), "second", &value), Albinos::SUCCESS);
+        CHECK_EQ(value, 2);
+        CHECK_EQ(Albinos::getSettingInt(config.get(), "removed", &value), Albinos::UNKNOWN_SETTING);
+    }
+    SUBCASE("cancelled changes are never sent") {
+        REQUIRE_EQ(Albinos::beginUpdate(config.get()), Albinos::SUCCESS);
+        REQUIRE_EQ(Albinos::setSettingInt(config.get(), "cancelled", 1), Albinos::SUCCESS);
+        REQUIRE_EQ(Albinos::removeSetting(config.get(), "removed"), Albinos::SUCCESS);
+        REQUIRE_EQ(Albinos::cancelUpdate(config.get()), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::commitUpdate(config.get()), Albinos::NO_UPDATE_IN_PROGRESS);
+        int64_t value = 1;
+        CHECK_EQ(Albinos::getSettingInt(config.get(), "cancelled", &value), Albinos::UNKNOWN_SETTING);
+        REQUIRE_EQ(Albinos::getSettingInt(config.get(), "removed", &value), Albinos::SUCCESS);
+        CHECK_EQ(value, 0);
+    }
+}
+
+TEST_CASE ("tracing")
+{
+    SUBCASE("without a config only the library is traced") {
+        auto path = std::filesystem::current_path() / "albinos_lib_test_trace.json";
+        setenv("ALBINOS_SOCKET_PATH", "/nonexistent/albinos_lib_test.sock", 1);
+        CHECK_EQ(Albinos::setTracingEnabled(1), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::writeTrace(path.c_str()), Albinos::SUCCESS);
+        CHECK_EQ(Albinos::setTracingEnabled(0), Albinos::SUCCESS);
+        CHECK(std::filesystem::exists(path));
+        std::filesystem::remove(path);
+    }
+}